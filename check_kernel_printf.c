@@ -22,6 +22,7 @@
 #include <string.h>
 #include "smatch.h"
 #include "smatch_slist.h"
+#include "smatch_literals.h"
 
 #define spam(args...) do {			\
 	if (option_spammy)			\
@@ -40,257 +41,6 @@ static int my_id;
 typedef unsigned char u8;
 typedef signed short s16;
 
-#define SIGN	1		/* unsigned/signed, must be 1 */
-#define LEFT	2		/* left justified */
-#define PLUS	4		/* show plus */
-#define SPACE	8		/* space if plus */
-#define ZEROPAD	16		/* pad with zero, must be 16 == '0' - ' ' */
-#define SMALL	32		/* use lowercase in hex (must be 32 == 0x20) */
-#define SPECIAL	64		/* prefix hex with "0x", octal with "0" */
-
-enum format_type {
-	FORMAT_TYPE_NONE, /* Just a string part */
-	FORMAT_TYPE_WIDTH,
-	FORMAT_TYPE_PRECISION,
-	FORMAT_TYPE_CHAR,
-	FORMAT_TYPE_STR,
-	FORMAT_TYPE_PTR,
-	FORMAT_TYPE_PERCENT_CHAR,
-	FORMAT_TYPE_INVALID,
-	FORMAT_TYPE_LONG_LONG,
-	FORMAT_TYPE_ULONG,
-	FORMAT_TYPE_LONG,
-	FORMAT_TYPE_UBYTE,
-	FORMAT_TYPE_BYTE,
-	FORMAT_TYPE_USHORT,
-	FORMAT_TYPE_SHORT,
-	FORMAT_TYPE_UINT,
-	FORMAT_TYPE_INT,
-	FORMAT_TYPE_SIZE_T,
-	FORMAT_TYPE_PTRDIFF,
-	FORMAT_TYPE_NRCHARS, /* Reintroduced for this checker */
-	FORMAT_TYPE_FLOAT, /* for various floating point formatters */
-};
-
-struct printf_spec {
-	unsigned int	type:8;		/* format_type enum */
-	signed int	field_width:24;	/* width of output field */
-	unsigned int	flags:8;	/* flags to number() */
-	unsigned int	base:8;		/* number base, 8, 10 or 16 only */
-	signed int	precision:16;	/* # of digits/chars */
-} __packed;
-#define FIELD_WIDTH_MAX ((1 << 23) - 1)
-#define PRECISION_MAX ((1 << 15) - 1)
-extern char __check_printf_spec[1-2*(sizeof(struct printf_spec) != 8)];
-
-static int
-skip_atoi(const char **s)
-{
-	int i = 0;
-
-	while (isdigit(**s))
-		i = i*10 + *((*s)++) - '0';
-
-	return i;
-}
-
-static int
-format_decode(const char *fmt, struct printf_spec *spec)
-{
-	const char *start = fmt;
-	char qualifier;
-
-	/* we finished early by reading the field width */
-	if (spec->type == FORMAT_TYPE_WIDTH) {
-		if (spec->field_width < 0) {
-			spec->field_width = -spec->field_width;
-			spec->flags |= LEFT;
-		}
-		spec->type = FORMAT_TYPE_NONE;
-		goto precision;
-	}
-
-	/* we finished early by reading the precision */
-	if (spec->type == FORMAT_TYPE_PRECISION) {
-		if (spec->precision < 0)
-			spec->precision = 0;
-
-		spec->type = FORMAT_TYPE_NONE;
-		goto qualifier;
-	}
-
-	/* By default */
-	spec->type = FORMAT_TYPE_NONE;
-
-	for (; *fmt ; ++fmt) {
-		if (*fmt == '%')
-			break;
-	}
-
-	/* Return the current non-format string */
-	if (fmt != start || !*fmt)
-		return fmt - start;
-
-	/* Process flags */
-	spec->flags = 0;
-
-	while (1) { /* this also skips first '%' */
-		bool found = true;
-
-		++fmt;
-
-		switch (*fmt) {
-		case '-': spec->flags |= LEFT;    break;
-		case '+': spec->flags |= PLUS;    break;
-		case ' ': spec->flags |= SPACE;   break;
-		case '#': spec->flags |= SPECIAL; break;
-		case '0': spec->flags |= ZEROPAD; break;
-		default:  found = false;
-		}
-
-		if (!found)
-			break;
-	}
-
-	/* get field width */
-	spec->field_width = -1;
-
-	if (isdigit(*fmt))
-		spec->field_width = skip_atoi(&fmt);
-	else if (*fmt == '*') {
-		/* it's the next argument */
-		spec->type = FORMAT_TYPE_WIDTH;
-		return ++fmt - start;
-	}
-
-precision:
-	/* get the precision */
-	spec->precision = -1;
-	if (*fmt == '.') {
-		++fmt;
-		if (isdigit(*fmt)) {
-			spec->precision = skip_atoi(&fmt);
-			if (spec->precision < 0)
-				spec->precision = 0;
-		} else if (*fmt == '*') {
-			/* it's the next argument */
-			spec->type = FORMAT_TYPE_PRECISION;
-			return ++fmt - start;
-		}
-	}
-
-qualifier:
-	/* get the conversion qualifier */
-	qualifier = 0;
-	if (*fmt == 'h' || _tolower(*fmt) == 'l' ||
-	    _tolower(*fmt) == 'z' || *fmt == 't') {
-		qualifier = *fmt++;
-		if (qualifier == *fmt) {
-			if (qualifier == 'l') {
-				qualifier = 'L';
-				++fmt;
-			} else if (qualifier == 'h') {
-				qualifier = 'H';
-				++fmt;
-			} else {
-				sm_warning("invalid repeated qualifier '%c'", *fmt);
-			}
-		}
-	}
-
-	/* default base */
-	spec->base = 10;
-	switch (*fmt) {
-	case 'c':
-		if (qualifier)
-			sm_warning("qualifier '%c' ignored for %%c specifier", qualifier);
-
-		spec->type = FORMAT_TYPE_CHAR;
-		return ++fmt - start;
-
-	case 's':
-		if (qualifier && qualifier != 'l')
-			sm_warning("qualifier '%c' ignored for %%s specifier", qualifier);
-
-		spec->type = FORMAT_TYPE_STR;
-		return ++fmt - start;
-
-	case 'p':
-		spec->type = FORMAT_TYPE_PTR;
-		return ++fmt - start;
-
-	case '%':
-		spec->type = FORMAT_TYPE_PERCENT_CHAR;
-		return ++fmt - start;
-
-	/* integer number formats - set up the flags and "break" */
-	case 'o':
-		spec->base = 8;
-		break;
-
-	case 'x':
-		spec->flags |= SMALL;
-
-	case 'X':
-		spec->base = 16;
-		break;
-
-	case 'd':
-	case 'i':
-		spec->flags |= SIGN;
-	case 'u':
-		break;
-
-	case 'n':
-		spec->type = FORMAT_TYPE_NRCHARS;
-		return ++fmt - start;
-
-	case 'a': case 'A':
-	case 'e': case 'E':
-	case 'f': case 'F':
-	case 'g': case 'G':
-		spec->type = FORMAT_TYPE_FLOAT;
-		return ++fmt - start;
-
-	default:
-		spec->type = FORMAT_TYPE_INVALID;
-		/* Unlike the kernel code, we 'consume' the invalid
-		 * character so that it can get included in the
-		 * report. After that, we bail out. */
-		return ++fmt - start;
-	}
-
-	if (qualifier == 'L')
-		spec->type = FORMAT_TYPE_LONG_LONG;
-	else if (qualifier == 'l') {
-		if (spec->flags & SIGN)
-			spec->type = FORMAT_TYPE_LONG;
-		else
-			spec->type = FORMAT_TYPE_ULONG;
-	} else if (_tolower(qualifier) == 'z') {
-		spec->type = FORMAT_TYPE_SIZE_T;
-	} else if (qualifier == 't') {
-		spec->type = FORMAT_TYPE_PTRDIFF;
-	} else if (qualifier == 'H') {
-		if (spec->flags & SIGN)
-			spec->type = FORMAT_TYPE_BYTE;
-		else
-			spec->type = FORMAT_TYPE_UBYTE;
-	} else if (qualifier == 'h') {
-		if (spec->flags & SIGN)
-			spec->type = FORMAT_TYPE_SHORT;
-		else
-			spec->type = FORMAT_TYPE_USHORT;
-	} else {
-		if (spec->flags & SIGN)
-			spec->type = FORMAT_TYPE_INT;
-		else
-			spec->type = FORMAT_TYPE_UINT;
-	}
-
-	return ++fmt - start;
-}
-
 static int is_struct_tag(struct symbol *type, const char *tag)
 {
 	return type->type == SYM_STRUCT && type->ident && !strcmp(type->ident->name, tag);
@@ -1023,15 +773,33 @@ free:
 	free_string(name);
 }
 
+static void
+print_format_warning(struct format_spec *fs)
+{
+	switch (fs->warn) {
+	case FORMAT_WARN_REPEATED_QUALIFIER:
+		sm_warning("invalid repeated qualifier '%c'", fs->qualifier);
+		break;
+	case FORMAT_WARN_CHAR_QUALIFIER:
+		sm_warning("qualifier '%c' ignored for %%c specifier", fs->qualifier);
+		break;
+	case FORMAT_WARN_STR_QUALIFIER:
+		sm_warning("qualifier '%c' ignored for %%s specifier", fs->qualifier);
+		break;
+	}
+}
+
 static void
 do_check_printf_call(const char *caller, const char *name, struct expression *callexpr, struct expression *fmtexpr, int vaidx)
 {
 	struct printf_spec spec = {0};
 	struct printf_spec prev_spec = {0};
+	struct format_spec *specs;
 	struct expression *arg;
 	struct expression *prev_arg = NULL;
 	const char *fmt, *orig_fmt;
 	int caller_in_fmt;
+	int nr_specs, i;
 
 	fmtexpr = strip_parens(fmtexpr);
 	if (fmtexpr->type == EXPR_CONDITIONAL) {
@@ -1072,14 +840,18 @@ do_check_printf_call(const char *caller, const char *name, struct expression *ca
 		return;
 	}
 
-	orig_fmt = fmt = fmtexpr->string->data;
-	caller_in_fmt = check_format_string(fmt, caller);
+	orig_fmt = fmtexpr->string->data;
+	caller_in_fmt = check_format_string(orig_fmt, caller);
+
+	specs = get_literal_format_specs(fmtexpr->string, &nr_specs);
+	for (i = 0; i < nr_specs; i++) {
+		const char *old_fmt = orig_fmt + specs[i].offset;
+		int read = specs[i].len;
 
-	while (*fmt) {
-		const char *old_fmt = fmt;
-		int read = format_decode(fmt, &spec);
+		fmt = old_fmt + read;
+		spec = specs[i].spec;
+		print_format_warning(&specs[i]);
 
-		fmt += read;
 		if (spec.type == FORMAT_TYPE_NONE ||
 		    spec.type == FORMAT_TYPE_PERCENT_CHAR) {
 			prev_spec = spec;
@@ -1097,7 +869,7 @@ do_check_printf_call(const char *caller, const char *name, struct expression *ca
 		 */
 		arg = get_argument_from_call_expr(callexpr->args, vaidx++);
 
-		if (spec.flags & SPECIAL && has_hex_prefix(orig_fmt, old_fmt))
+		if (spec.flags & FMT_SPECIAL && has_hex_prefix(orig_fmt, old_fmt))
 			sm_warning("'%.2s' prefix is redundant when # flag is used", old_fmt-2);
 		if (is_integer_specifier(spec.type)) {
 			if (spec.base != 16 && has_hex_prefix(orig_fmt, old_fmt))
@@ -1159,8 +931,6 @@ do_check_printf_call(const char *caller, const char *name, struct expression *ca
 		case FORMAT_TYPE_PTR:
 			/* This is the most important part: Checking %p extensions. */
 			pointer(fmt, arg, vaidx);
-			while (isalnum(*fmt))
-				fmt++;
 			break;
 
 		case FORMAT_TYPE_CHAR:
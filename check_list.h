@@ -22,6 +22,8 @@ CK(register_modification_hooks)
 CK(register_implications)
 CK(register_function_hooks_early)
 CK(register_definition_db_callbacks)
+CK(register_db_prefetch)
+CK(register_fn_cache)
 CK(register_project)        /* has to be early to set up some global stuff */
 CK(register_untracked_param)
 CK(register_param_compare_limit)
@@ -55,6 +57,7 @@ CK(register_function_info)
 CK(register_type_links)
 CK(register_impossible)
 CK(register_impossible_return)
+CK(register_literals)
 CK(register_strings)
 CK(register_integer_overflow)
 CK(register_integer_overflow_links)
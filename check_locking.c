@@ -21,6 +21,7 @@
 #include "smatch.h"
 #include "smatch_extra.h"
 #include "smatch_slist.h"
+#include "smatch_function_hashtable.h"
 
 static int my_id;
 
@@ -457,6 +458,19 @@ static const char *false_positives[][2] = {
 
 static struct stree *start_states;
 
+DEFINE_STRING_HASHTABLE_STATIC(lock_funcs);
+
+/*
+ * Each lock name is interned the first time it is set in a function and
+ * every suffix of the name which starts after a non-alnum char points back
+ * to it.  That's what get_best_match() looks for so it's one hash lookup
+ * instead of a strcmp() against every held lock.
+ */
+DEFINE_FUNCTION_HASHTABLE_STATIC(lock_name, struct tracker, struct tracker_list);
+DEFINE_FUNCTION_HASHTABLE_STATIC(lock_suffix, struct tracker, struct tracker_list);
+static struct hashtable *lock_names;
+static struct hashtable *lock_suffixes;
+
 static struct tracker_list *locks;
 
 static struct expression *ignored_reset;
@@ -536,12 +550,39 @@ static struct smatch_state *merge_func(struct smatch_state *s1, struct smatch_st
 	return &merged;
 }
 
+static void intern_lock_name(int owner, const char *name, struct symbol *sym, struct smatch_state *state)
+{
+	struct tracker *tracker;
+	int i, len;
+
+	if (!lock_names) {
+		lock_names = create_function_hashtable(100);
+		lock_suffixes = create_function_hashtable(500);
+	}
+
+	if (in_tracker_list(search_lock_name(lock_names, (char *)name), my_id, name, sym))
+		return;
+
+	tracker = alloc_tracker(my_id, name, sym);
+	add_lock_name(lock_names, name, tracker);
+
+	len = strlen(name);
+	for (i = 0; i <= len; i++) {
+		if (i == 0 || !isalnum(name[i - 1]))
+			add_lock_suffix(lock_suffixes, name + i, tracker);
+	}
+}
+
 static struct sm_state *get_best_match(const char *key, int lock_unlock)
 {
+	struct tracker *tracker;
 	struct sm_state *sm;
 	struct sm_state *match;
 	int cnt = 0;
-	int start_pos, state_len, key_len, chunks, i;
+	int key_len, chunks, i;
+
+	if (!lock_suffixes)
+		return NULL;
 
 	if (strncmp(key, "$->", 3) == 0)
 		key += 3;
@@ -553,26 +594,21 @@ static struct sm_state *get_best_match(const char *key, int lock_unlock)
 			chunks++;
 		if (chunks == 2) {
 			key += (i + 1);
-			key_len = strlen(key);
 			break;
 		}
 	}
 
-	FOR_EACH_MY_SM(my_id, __get_cur_stree(), sm) {
+	FOR_EACH_PTR(search_lock_suffix(lock_suffixes, (char *)key), tracker) {
+		sm = get_sm_state(my_id, tracker->name, tracker->sym);
+		if (!sm)
+			continue;
 		if (((lock_unlock == UNLOCK || lock_unlock == RESTORE) &&
 		     sm->state != &locked) ||
 		    (lock_unlock == LOCK && sm->state != &unlocked))
 			continue;
-		state_len = strlen(sm->name);
-		if (state_len < key_len)
-			continue;
-		start_pos = state_len - key_len;
-		if ((start_pos == 0 || !isalnum(sm->name[start_pos - 1])) &&
-		    strcmp(sm->name + start_pos, key) == 0) {
-			cnt++;
-			match = sm;
-		}
-	} END_FOR_EACH_SM(sm);
+		cnt++;
+		match = sm;
+	} END_FOR_EACH_PTR(tracker);
 
 	if (cnt == 1)
 		return match;
@@ -942,16 +978,10 @@ static int success_fail_positive(struct range_list *rl)
 
 static bool sym_in_lock_table(struct symbol *sym)
 {
-	int i;
-
 	if (!sym || !sym->ident)
 		return false;
 
-	for (i = 0; lock_table[i].function != NULL; i++) {
-		if (strcmp(lock_table[i].function, sym->ident->name) == 0)
-			return true;
-	}
-	return false;
+	return !!search_lock_funcs(lock_funcs, (char *)sym->ident->name);
 }
 
 static bool func_in_lock_table(struct expression *expr)
@@ -974,9 +1004,6 @@ static void check_lock(char *name, struct symbol *sym)
 	int bucket;
 	int i;
 
-	if (sym_in_lock_table(cur_func_sym))
-		return;
-
 	FOR_EACH_PTR(get_all_return_strees(), stree) {
 		orig = __swap_cur_stree(stree);
 
@@ -1047,6 +1074,9 @@ static void match_func_end(struct symbol *sym)
 {
 	struct tracker *tracker;
 
+	if (sym_in_lock_table(cur_func_sym))
+		return;
+
 	FOR_EACH_PTR(locks, tracker) {
 		check_lock(tracker->name, tracker->sym);
 	} END_FOR_EACH_PTR(tracker);
@@ -1234,6 +1264,12 @@ static void set_unlocked(const char *name, struct symbol *sym, char *value)
 static void match_after_func(struct symbol *sym)
 {
 	free_stree(&start_states);
+	if (lock_names) {
+		destroy_function_hashtable(lock_names);
+		destroy_function_hashtable(lock_suffixes);
+		lock_names = NULL;
+		lock_suffixes = NULL;
+	}
 }
 
 static void match_dma_resv_lock_NULL(const char *fn, struct expression *call_expr,
@@ -1280,6 +1316,8 @@ static void load_table(struct lock_info *lock_table)
 	for (i = 0; lock_table[i].function != NULL; i++) {
 		struct lock_info *lock = &lock_table[i];
 
+		insert_lock_funcs(lock_funcs, (char *)lock->function, (void *)1);
+
 		if (lock->call_back) {
 			add_function_hook(lock->function, lock->call_back, lock);
 		} else if (lock->implies_start) {
@@ -1311,6 +1349,7 @@ void check_locking(int id)
 	if (!is_smp_config())
 		return;
 
+	lock_funcs = create_function_hashtable(500);
 	load_table(lock_table);
 
 	set_dynamic_states(my_id);
@@ -1324,6 +1363,9 @@ void check_locking(int id)
 
 	add_hook(&match_after_func, AFTER_FUNC_HOOK);
 	add_function_data((unsigned long *)&start_states);
+	add_function_data((unsigned long *)&lock_names);
+	add_function_data((unsigned long *)&lock_suffixes);
+	add_check_tracker("check_locking", &intern_lock_name);
 
 	add_caller_info_callback(my_id, call_info_callback);
 	add_hook(&match_call_info, FUNCTION_CALL_HOOK);
@@ -16,6 +16,7 @@
  */
 
 #include "smatch.h"
+#include "smatch_literals.h"
 
 static void match_snprintf(const char *fn, struct expression *expr, void *unused)
 {
@@ -26,7 +27,6 @@ static void match_snprintf(const char *fn, struct expression *expr, void *unused
 	char *data_name = NULL;
 	int dest_size;
 	sval_t limit_size;
-	char *format;
 	int data_size;
 
 	dest = get_argument_from_call_expr(expr->args, 0);
@@ -40,11 +40,8 @@ static void match_snprintf(const char *fn, struct expression *expr, void *unused
 	if (dest_size > 1 && dest_size < limit_size.value)
 		sm_error("snprintf() is printing too much %s vs %d",
 			 sval_to_str(limit_size), dest_size);
-	format = expr_to_var(format_string);
-	if (!format)
+	if (!is_string_literal(format_string, "%s"))
 		return;
-	if (strcmp(format, "\"%s\""))
-		goto free;
 	data_name = expr_to_str(data);
 	data_size = get_size_from_strlen(data);
 	if (!data_size)
@@ -52,9 +49,7 @@ static void match_snprintf(const char *fn, struct expression *expr, void *unused
 	if (limit_size.value < data_size)
 		sm_error("snprintf() chops off the last chars of '%s': %d vs %s",
 		       data_name, data_size, sval_to_str(limit_size));
-free:
 	free_string(data_name);
-	free_string(format);
 }
 
 void check_snprintf_overflow(int id)
@@ -16,6 +16,7 @@
  */
 
 #include "smatch.h"
+#include "smatch_literals.h"
 
 static void match_sprintf(const char *fn, struct expression *expr, void *unused)
 {
@@ -24,7 +25,6 @@ static void match_sprintf(const char *fn, struct expression *expr, void *unused)
 	struct expression *data;
 	char *data_name = NULL;
 	int dest_size;
-	char *format;
 	int data_size;
 
 	dest = get_argument_from_call_expr(expr->args, 0);
@@ -34,11 +34,8 @@ static void match_sprintf(const char *fn, struct expression *expr, void *unused)
 	dest_size = get_array_size_bytes(dest);
 	if (!dest_size)
 		return;
-	format = expr_to_var(format_string);
-	if (!format)
+	if (!is_string_literal(format_string, "%s"))
 		return;
-	if (strcmp(format, "\"%s\""))
-		goto free;
 	data_name = expr_to_str(data);
 	data_size = get_size_from_strlen(data);
 	if (!data_size)
@@ -46,9 +43,7 @@ static void match_sprintf(const char *fn, struct expression *expr, void *unused)
 	if (dest_size < data_size)
 		sm_error("sprintf() copies too much data from '%s': %d vs %d",
 		       data_name, data_size, dest_size);
-free:
 	free_string(data_name);
-	free_string(format);
 }
 
 void check_sprintf_overflow(int id)
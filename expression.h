@@ -178,6 +178,7 @@ struct expression {
 	unsigned flags:8;
 	unsigned smatch_flags:16;
 	unsigned zero_init:1;
+	unsigned parsed_gen:28;	/* see already_parsed_call() */
 	int op;
 	struct position pos;
 	struct symbol *ctype;
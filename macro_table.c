@@ -27,70 +27,152 @@
 #include <string.h>
 #include "lib.h"
 #include "parse.h"
-#include "cwchash/hashtable.h"
-
-static struct hashtable *macro_table;
-
-static DEFINE_HASHTABLE_INSERT(do_insert_macro, struct position, struct string_list);
-static DEFINE_HASHTABLE_SEARCH(do_search_macro, struct position, struct string_list);
-
-static inline unsigned int position_hash(void *_pos)
+/*
+ * Every stream has an array of the positions where a macro was expanded,
+ * sorted by line and column.  When a macro is expanded inside another
+ * macro the tokens have the position of the outer macro so there can be
+ * several entries for one position.  Those are kept in the order they
+ * were expanded and ->depth is 0 for the outermost macro.
+ */
+struct macro_pos {
+	unsigned int line;
+	unsigned short pos;
+	unsigned short depth;
+	struct ident *macro;
+};
+
+struct macro_table {
+	struct macro_pos *entries;
+	int nr, alloc;
+};
+
+static struct macro_table *tables;
+static int nr_tables;
+
+static struct macro_table *get_macro_table(struct position pos)
 {
-	struct position *pos = _pos;
-
-	return pos->line | (pos->pos << 22) | (pos->stream << 18);
+	int nr = nr_tables;
+
+	if (pos.stream >= nr_tables) {
+		nr_tables = pos.stream + 1;
+		tables = realloc(tables, nr_tables * sizeof(*tables));
+		if (!tables)
+			die("out of memory storing macros");
+		memset(tables + nr, 0, (nr_tables - nr) * sizeof(*tables));
+	}
+	return &tables[pos.stream];
 }
 
-static inline int equalkeys(void *_pos1, void *_pos2)
+static int compare_pos(struct macro_pos *entry, struct position pos)
 {
-	struct position *pos1 = _pos1;
-	struct position *pos2 = _pos2;
-
-	return pos1->line == pos2->line && pos1->pos == pos2->pos &&
-		pos1->stream == pos2->stream;
+	if (entry->line != pos.line)
+		return entry->line < pos.line ? -1 : 1;
+	if (entry->pos != pos.pos)
+		return entry->pos < pos.pos ? -1 : 1;
+	return 0;
 }
 
-static void insert_macro_string(struct string_list **str_list, char *new)
+/* returns the first entry which is not before @pos */
+static int lower_bound(struct macro_table *table, struct position pos)
 {
-	add_ptr_list(str_list, new);
+	int lo = 0, hi = table->nr, mid;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if (compare_pos(&table->entries[mid], pos) < 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
 }
 
 void store_macro_pos(struct token *token)
 {
-	struct string_list *list;
-
-	if (!macro_table)
-		macro_table = create_hashtable(5000, position_hash, equalkeys);
-
-	list = do_search_macro(macro_table, &token->pos);
-	insert_macro_string(&list, token->ident->name);
+	struct macro_table *table = get_macro_table(token->pos);
+	struct macro_pos *entry;
+	int idx, depth = 0;
+
+	if (table->nr == table->alloc) {
+		table->alloc = table->alloc ? table->alloc * 2 : 1024;
+		table->entries = realloc(table->entries, table->alloc * sizeof(*table->entries));
+		if (!table->entries)
+			die("out of memory storing macros");
+	}
+
+	/*
+	 * The positions mostly come in order.  The exception is the body of
+	 * a macro which is scanned after its arguments.
+	 */
+	idx = table->nr;
+	if (idx && compare_pos(&table->entries[idx - 1], token->pos) >= 0) {
+		idx = lower_bound(table, token->pos);
+		while (idx < table->nr &&
+		       compare_pos(&table->entries[idx], token->pos) == 0) {
+			depth++;
+			idx++;
+		}
+		memmove(&table->entries[idx + 1], &table->entries[idx],
+			(table->nr - idx) * sizeof(*table->entries));
+	}
+
+	entry = &table->entries[idx];
+	entry->line = token->pos.line;
+	entry->pos = token->pos.pos;
+	entry->depth = depth;
+	entry->macro = token->ident;
+	table->nr++;
+}
 
-	do_insert_macro(macro_table, &token->pos, list);
+/* returns the number of macros expanded at @pos */
+static int find_macros(struct position pos, struct macro_pos **first)
+{
+	struct macro_table *table;
+	int idx, nr = 0;
+
+	if (pos.stream >= nr_tables)
+		return 0;
+	table = &tables[pos.stream];
+	idx = lower_bound(table, pos);
+	while (idx + nr < table->nr &&
+	       compare_pos(&table->entries[idx + nr], pos) == 0)
+		nr++;
+	*first = &table->entries[idx];
+	return nr;
 }
 
 char *get_macro_name(struct position pos)
 {
-	struct string_list *list;
+	struct macro_pos *first;
 
-	if (!macro_table)
+	if (!find_macros(pos, &first))
 		return NULL;
-	list = do_search_macro(macro_table, &pos);
-	return first_ptr_list((struct ptr_list *)list);
+	return first->macro->name;
 }
 
 char *get_inner_macro(struct position pos)
 {
-	struct string_list *list;
+	struct macro_pos *first;
+	int nr;
 
-	if (!macro_table)
+	nr = find_macros(pos, &first);
+	if (!nr)
 		return NULL;
-	list = do_search_macro(macro_table, &pos);
-	return last_ptr_list((struct ptr_list *)list);
+	return first[nr - 1].macro->name;
 }
 
+/* the list is allocated for the caller, outermost macro first */
 struct string_list *get_all_macros(struct position pos)
 {
-	if (!macro_table)
-		return NULL;
-	return do_search_macro(macro_table, &pos);
+	struct string_list *list = NULL;
+	struct macro_pos *first;
+	char *name;
+	int i, nr;
+
+	nr = find_macros(pos, &first);
+	for (i = 0; i < nr; i++) {
+		name = first[i].macro->name;
+		add_ptr_list(&list, name);
+	}
+	return list;
 }
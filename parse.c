@@ -2842,6 +2842,7 @@ static struct token *parse_function_body(struct token *token, struct symbol *dec
 		}
 	}
 	function_symbol_list = old_symbol_list;
+	decl->endpos = token->pos;
 	if (function_computed_goto_list) {
 		if (!function_computed_target_list)
 			warning(decl->pos, "function '%s' has computed goto but no targets?", show_ident(decl->ident));
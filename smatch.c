@@ -27,6 +27,7 @@ char *option_debug_var;
 char *option_process_function;
 char *option_project_str = (char *)"smatch_generic";
 static char *option_db_file = (char *)"smatch_db.sqlite";
+char *option_fn_cache;
 enum project_type option_project = PROJ_NONE;
 char *bin_dir;
 char *data_dir;
@@ -38,6 +39,8 @@ int option_info = 0;
 int option_full_path = 0;
 int option_call_tree = 0;
 int option_no_db = 0;
+int option_db_prefetch;
+int option_db_shard;
 int option_enable = 0;
 int option_disable = 0;
 int option_file_output;
@@ -143,6 +146,7 @@ static void help(void)
 	printf("--spammy:  print superfluous crap.\n");
 	printf("--pedantic:  intended for reviewing new drivers.\n");
 	printf("--info:  print info used to fill smatch_data/.\n");
+	printf("--info-frames:  with --info, print the SQL as records (see smatch_info_frames.c).\n");
 	printf("--debug:  print lots of debug output.\n");
 	printf("--no-data:  do not use the /smatch_data/ directory.\n");
 	printf("--data=<dir>: overwrite path to default smatch data directory.\n");
@@ -152,6 +156,12 @@ static void help(void)
 	printf("--two-passes:  use a two pass system for each function.\n");
 	printf("--file-output:  instead of printing stdout, print to \"file.c.smatch_out\".\n");
 	printf("--fatal-checks: check output is treated as an error.\n");
+	printf("--db-shard:  with --info, save the SQL in \"file.c.smatch.db\".\n");
+	printf("--db-prefetch:  load the DB info for called functions on a separate thread.\n");
+	printf("--fn-cache=<file>:  reuse the warnings for functions which haven't changed.\n");
+	printf("--changed=<patch>:  only check the functions a patch changes (\"-\" is stdin).\n");
+	printf("--changed-lines=<ranges>:  the same but for lines like \"10-20,35\".\n");
+	printf("--tiered:  parse with a cheap pass first and redo the functions which warn.\n");
 	printf("--help:  print this helpful message.\n");
 	exit(1);
 }
@@ -209,6 +219,11 @@ void parse_args(int *argcp, char ***argvp)
 			(*argvp)[1] = (*argvp)[0];
 			found = 1;
 		}
+		if (!found && !strncmp((*argvp)[1], "--fn-cache=", 11)) {
+			option_fn_cache = (*argvp)[1] + 11;
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
 		if (!found && !strncmp((*argvp)[1], "--data=", 7)) {
 			option_datadir_str = (*argvp)[1] + 7;
 			(*argvp)[1] = (*argvp)[0];
@@ -237,6 +252,16 @@ void parse_args(int *argcp, char ***argvp)
 			(*argvp)[1] = (*argvp)[0];
 			found = 1;
 		}
+		if (!found && strncmp((*argvp)[1], "--changed=", 10) == 0) {
+			option_changed = (*argvp)[1] + 10;
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
+		if (!found && strncmp((*argvp)[1], "--changed-lines=", 16) == 0) {
+			option_changed_lines = (*argvp)[1] + 16;
+			(*argvp)[1] = (*argvp)[0];
+			found = 1;
+		}
 		if (!found && strncmp((*argvp)[1], "--function=", 11) == 0) {
 			option_process_function = (*argvp)[1] + 11;
 			(*argvp)[1] = (*argvp)[0];
@@ -247,6 +272,7 @@ void parse_args(int *argcp, char ***argvp)
 		OPTION(spammy);
 		OPTION(pedantic);
 		OPTION(info);
+		OPTION(info_frames);
 		OPTION(debug);
 		OPTION(assume_loops);
 		OPTION(no_data);
@@ -258,8 +284,11 @@ void parse_args(int *argcp, char ***argvp)
 		OPTION(time_stmt);
 		OPTION(mem);
 		OPTION(no_db);
+		OPTION(db_prefetch);
+		OPTION(db_shard);
 		OPTION(succeed);
 		OPTION(print_names);
+		OPTION(tiered);
 		if (!found)
 			break;
 		(*argcp)--;
@@ -350,7 +379,11 @@ int main(int argc, char **argv)
 	sql_outfd = stdout;
 	caller_info_fd = stdout;
 
+	fn_cache_save_args(argc, argv);
 	parse_args(&argc, &argv);
+	info_frames_new_fd(stdout);
+	load_changed_lines();
+	check_tiered_options();
 
 	if (argc < 2)
 		help();
@@ -313,8 +313,11 @@ extern int sm_nr_errors;
  * sm_msg(): other message (please avoid using this)
  */
 
+/* Output is only printed on the final pass unless we're debugging. */
+#define sm_printing() (final_pass || option_debug || local_debug || debug_db)
+
 #define sm_printf(msg...) do {						\
-	if (final_pass || option_debug || local_debug || debug_db)	\
+	if (sm_printing())						\
 		fprintf(sm_outfd, msg);					\
 } while (0)
 
@@ -333,7 +336,7 @@ extern bool __silence_warnings_for_stmt;
 #define sm_print_msg(type, msg...) \
 do {                                                           \
 	print_implied_debug_msg();                             \
-	if (!final_pass && !option_debug && !local_debug && !debug_db)	  \
+	if (!sm_printing())				       \
 		break;                                         \
 	if (__silence_warnings_for_stmt && !option_debug && !local_debug) \
 		break;					       \
@@ -358,6 +361,64 @@ do {                                                           \
 
 #define sm_msg(msg...) do { sm_print_msg(0, msg); } while (0)
 
+/* smatch_ast_walk.c */
+struct ast_walk_ops {
+	void (*expr)(struct expression *expr, void *data);
+	void (*stmt)(struct statement *stmt, void *data);
+	void (*decl)(struct symbol *sym, void *data);
+};
+void walk_ast_expr(struct expression *expr, const struct ast_walk_ops *ops, void *data);
+void walk_ast_stmt(struct statement *stmt, const struct ast_walk_ops *ops, void *data);
+
+/* smatch_changed.c */
+extern char *option_changed;
+extern char *option_changed_lines;
+void load_changed_lines(void);
+void changed_lines_start_file(struct symbol_list *sym_list);
+bool changed_lines_skip_function(struct symbol *sym);
+bool changed_lines_skip_global(struct symbol *sym);
+bool changed_lines_silenced(void);
+
+/* smatch_tiered.c */
+extern int option_tiered;
+void check_tiered_options(void);
+bool tiered_cheap_pass(void);
+bool tiered_silenced(void);
+void tiered_start_cheap_pass(void);
+bool tiered_end_cheap_pass(void);
+void tiered_end_full_pass(void);
+void print_tiered_stats(void);
+
+/* smatch_info_frames.c */
+extern int option_info_frames;
+void info_frames_new_fd(FILE *fd);
+void print_info_frame(FILE *fd, char type, const char *ignore,
+		      const char *table, const char *fmt, ...);
+
+/*
+ * The SQL lines for --info.  They follow the sm_msg() rules but with
+ * --info-frames they are printed as records instead of text.
+ */
+#define __sm_sql(fd, type, kind, msg...) do {				\
+	FILE *__tmp_fd = sm_outfd;					\
+									\
+	if (option_info_frames) {					\
+		if (!sm_printing())					\
+			break;						\
+		if (__silence_warnings_for_stmt && !option_debug && !local_debug) \
+			break;						\
+		print_info_frame(fd, type, NULL, NULL, msg);		\
+		break;							\
+	}								\
+	sm_outfd = fd;							\
+	sm_msg("SQL" kind ": " msg);					\
+	sm_outfd = __tmp_fd;						\
+} while (0)
+
+#define sm_sql(msg...) __sm_sql(sm_outfd, 'S', "", msg)
+#define sm_sql_late(msg...) __sm_sql(sm_outfd, 'L', "_late", msg)
+#define sm_sql_caller_info(msg...) __sm_sql(caller_info_fd, 'C', "_caller_info", msg)
+
 extern char *implied_debug_msg;
 static inline void print_implied_debug_msg(void)
 {
@@ -657,6 +718,7 @@ void free_trackers_and_list(struct tracker_list **list);
 int in_condition(void);
 
 /* smatch_flow.c */
+void add_inline_function(struct symbol *sym);
 
 extern int __in_fake_assign;
 extern int __in_fake_parameter_assign;
@@ -682,6 +744,9 @@ extern int __in_unmatched_hook;
 extern int option_assume_loops;
 extern int option_two_passes;
 extern int option_no_db;
+extern int option_db_prefetch;
+extern int option_db_shard;
+extern char *option_fn_cache;
 extern int option_file_output;
 extern int option_time;
 extern int option_time_stmt;
@@ -764,9 +829,14 @@ int get_absolute_max_helper(struct expression *expr, sval_t *sval);
 /* smatch_type_value.c */
 void disable_type_val_lookups(void);
 void enable_type_val_lookups(void);
-void clear_type_value_cache(void);
 int get_db_type_rl(struct expression *expr, struct range_list **rl);
 
+/* smatch_type_facts.c */
+struct range_list *get_member_type_value(const char *member, struct symbol *type);
+struct range_list *get_member_type_size(const char *member);
+const char *get_member_type_units(const char *member);
+struct range_list *get_file_type_size(const char *name);
+
 /* smatch_data_val.c */
 int get_mtag_rl(struct expression *expr, struct range_list **rl);
 /* smatch_array_values.c */
@@ -997,6 +1067,7 @@ enum info_type {
 extern struct sqlite3 *smatch_db;
 extern struct sqlite3 *mem_db;
 extern struct sqlite3 *cache_db;
+extern struct sqlite3 *shard_db;
 
 bool db_incomplete(void);
 void db_ignore_states(int id);
@@ -1032,9 +1103,14 @@ const char *get_mtag_name_expr(struct expression *expr);
 char *get_data_info_name(struct expression *expr);
 char *sm_to_arg_name(struct expression *expr, struct sm_state *sm);
 int is_recursive_member(const char *param_name);
+extern unsigned long long __fn_mtag;
+int get_return_id(void);
+void skip_return_ids(int count);
 
 char *escape_newlines(const char *str);
 void sql_exec(struct sqlite3 *db, int (*callback)(void*, int, char**, char**), void *data, const char *sql);
+void sql_queue_insert(struct sqlite3 *db, const char *ignore, const char *table, const char *values, ...);
+void sql_flush_batch(struct sqlite3 *db);
 
 #define sql_helper(db, call_back, data, sql...)					\
 do {										\
@@ -1065,23 +1141,26 @@ do {										\
 										\
 	if (__inline_fn && !_db)						\
 		_db = mem_db;							\
+	if (_db == cache_db && tiered_cheap_pass())				\
+		break;								\
 	if (_db) {								\
-		char buf[1024];							\
-		char *err, *p = buf;						\
-		int rc;								\
-										\
-		p += snprintf(p, buf + sizeof(buf) - p,				\
-			      "insert %sinto %s values (",			\
-			      ignore ? "or ignore " : "", #table);		\
-		p += snprintf(p, buf + sizeof(buf) - p, values);		\
-		p += snprintf(p, buf + sizeof(buf) - p, ");");			\
-		db_debug("mem-db: %s\n", buf);					\
-		rc = sqlite3_exec(_db, buf, NULL, NULL, &err);			\
-		if (rc != SQLITE_OK) {						\
-			sm_ierror("SQL error #2: %s", err);			\
-			sm_ierror("SQL: '%s'", buf);				\
-			parse_error = 1;					\
-		}								\
+		sql_queue_insert(_db, ignore ? "or ignore " : "", #table,	\
+				 values);					\
+		break;								\
+	}									\
+	if (option_info && shard_db && !late) {				\
+		if (!final_pass)					\
+			break;						\
+		sql_queue_insert(shard_db, ignore ? "or ignore " : "", #table,	\
+				 values);					\
+		break;								\
+	}									\
+	/* the same filtering that sm_printf() does below */		\
+	if (option_info && option_info_frames) {				\
+		if (!sm_printing())					\
+			break;							\
+		print_info_frame(sql_outfd, late ? 'L' : 'S',			\
+				 ignore ? "or ignore " : "", #table, values);	\
 		break;								\
 	}									\
 	if (option_info) {							\
@@ -1103,6 +1182,26 @@ do {										\
 #define sql_insert_cache_or_ignore(table, values...) sql_insert_helper(table, cache_db, 1, 0, values);
 
 char *get_static_filter(struct symbol *sym);
+void print_db_query_stats(void);
+void prefetch_return_states(struct expression *call);
+
+/* smatch_fn_cache.c */
+void fn_cache_save_args(int argc, char **argv);
+void fn_cache_start_file(struct symbol_list *sym_list);
+bool load_fn_results(struct symbol *sym);
+void save_fn_results(struct symbol *sym);
+bool load_inline_results(struct expression *call);
+void save_inline_results(struct expression *call);
+bool fn_cache_recording(struct sqlite3 *db);
+int fn_cache_exec(struct sqlite3 *db, const char *sql,
+		  int (*callback)(void*, int, char**, char**), void *data,
+		  char **err);
+void fn_cache_add_dep(struct sqlite3 *db, const char *sql);
+void fn_cache_add_insert(struct sqlite3 *db, const char *sql);
+void fn_cache_add_inline(struct symbol *sym);
+void fn_cache_add_mtag_data(const char *key, const char *value);
+void fn_cache_add_mtag_dep(const char *key, const char *value);
+void print_fn_cache_stats(void);
 
 void sql_insert_return_states(int return_id, const char *return_ranges,
 		int type, int param, const char *key, const char *value);
@@ -1141,6 +1240,9 @@ void sql_select_call_implies(const char *cols, struct expression *call,
 	int (*callback)(void*, int, char**, char**));
 
 void open_smatch_db(char *db_file);
+void open_db_shard(const char *base_file);
+void close_db_shard(void);
+void stop_db_prefetch(void);
 
 /* smatch_files.c */
 int open_data_file(const char *filename);
@@ -1469,6 +1571,8 @@ int get_toplevel_mtag(struct symbol *sym, mtag_t *tag);
 int create_mtag_alias(mtag_t tag, struct expression *expr, mtag_t *new);
 int expr_to_mtag_offset(struct expression *expr, mtag_t *tag, int *offset);
 void update_mtag_data(struct expression *expr, struct smatch_state *state);
+const char *get_mtag_data_value(const char *key);
+void replay_mtag_data(const char *lines);
 int get_mtag_sval(struct expression *expr, sval_t *sval);
 
 /* Trinity fuzzer stuff */
@@ -0,0 +1,157 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * A plain walk over a function body before the flow walker gets to it.
+ * It doesn't track any states, it just calls the ops->expr() hook on every
+ * expression, the ops->stmt() hook on every statement and the ops->decl()
+ * hook on every declared symbol.  The hooks are called before the walker
+ * goes into the children.
+ */
+
+#include "smatch.h"
+
+static void walk_declaration(struct symbol_list *sym_list, const struct ast_walk_ops *ops, void *data)
+{
+	struct symbol *sym;
+
+	FOR_EACH_PTR(sym_list, sym) {
+		if (ops->decl)
+			ops->decl(sym, data);
+		walk_ast_expr(sym->initializer, ops, data);
+	} END_FOR_EACH_PTR(sym);
+}
+
+void walk_ast_expr(struct expression *expr, const struct ast_walk_ops *ops, void *data)
+{
+	struct expression *tmp;
+
+	if (!expr)
+		return;
+
+	if (ops->expr)
+		ops->expr(expr, data);
+
+	switch (expr->type) {
+	case EXPR_CALL:
+		walk_ast_expr(expr->fn, ops, data);
+		FOR_EACH_PTR(expr->args, tmp) {
+			walk_ast_expr(tmp, ops, data);
+		} END_FOR_EACH_PTR(tmp);
+		break;
+	case EXPR_PREOP:
+	case EXPR_POSTOP:
+		walk_ast_expr(expr->unop, ops, data);
+		break;
+	case EXPR_BINOP:
+	case EXPR_COMMA:
+	case EXPR_COMPARE:
+	case EXPR_LOGICAL:
+	case EXPR_ASSIGNMENT:
+		walk_ast_expr(expr->left, ops, data);
+		walk_ast_expr(expr->right, ops, data);
+		break;
+	case EXPR_DEREF:
+		walk_ast_expr(expr->deref, ops, data);
+		break;
+	case EXPR_CAST:
+	case EXPR_FORCE_CAST:
+	case EXPR_IMPLIED_CAST:
+		walk_ast_expr(expr->cast_expression, ops, data);
+		break;
+	case EXPR_CONDITIONAL:
+	case EXPR_SELECT:
+		walk_ast_expr(expr->conditional, ops, data);
+		walk_ast_expr(expr->cond_true, ops, data);
+		walk_ast_expr(expr->cond_false, ops, data);
+		break;
+	case EXPR_STATEMENT:
+		walk_ast_stmt(expr->statement, ops, data);
+		break;
+	case EXPR_INITIALIZER:
+		FOR_EACH_PTR(expr->expr_list, tmp) {
+			walk_ast_expr(tmp, ops, data);
+		} END_FOR_EACH_PTR(tmp);
+		break;
+	case EXPR_IDENTIFIER:
+		walk_ast_expr(expr->ident_expression, ops, data);
+		break;
+	case EXPR_INDEX:
+		walk_ast_expr(expr->idx_expression, ops, data);
+		break;
+	case EXPR_POS:
+		walk_ast_expr(expr->init_expr, ops, data);
+		break;
+	default:
+		break;
+	}
+}
+
+void walk_ast_stmt(struct statement *stmt, const struct ast_walk_ops *ops, void *data)
+{
+	struct statement *tmp;
+
+	if (!stmt)
+		return;
+
+	if (ops->stmt)
+		ops->stmt(stmt, data);
+
+	switch (stmt->type) {
+	case STMT_DECLARATION:
+		walk_declaration(stmt->declaration, ops, data);
+		break;
+	case STMT_EXPRESSION:
+		walk_ast_expr(stmt->expression, ops, data);
+		break;
+	case STMT_RETURN:
+		walk_ast_expr(stmt->ret_value, ops, data);
+		break;
+	case STMT_COMPOUND:
+		FOR_EACH_PTR(stmt->stmts, tmp) {
+			walk_ast_stmt(tmp, ops, data);
+		} END_FOR_EACH_PTR(tmp);
+		break;
+	case STMT_IF:
+		walk_ast_expr(stmt->if_conditional, ops, data);
+		walk_ast_stmt(stmt->if_true, ops, data);
+		walk_ast_stmt(stmt->if_false, ops, data);
+		break;
+	case STMT_ITERATOR:
+		walk_ast_stmt(stmt->iterator_pre_statement, ops, data);
+		walk_ast_expr(stmt->iterator_pre_condition, ops, data);
+		walk_ast_stmt(stmt->iterator_statement, ops, data);
+		walk_ast_stmt(stmt->iterator_post_statement, ops, data);
+		walk_ast_expr(stmt->iterator_post_condition, ops, data);
+		break;
+	case STMT_SWITCH:
+		walk_ast_expr(stmt->switch_expression, ops, data);
+		walk_ast_stmt(stmt->switch_statement, ops, data);
+		break;
+	case STMT_CASE:
+		walk_ast_stmt(stmt->case_statement, ops, data);
+		break;
+	case STMT_LABEL:
+		walk_ast_stmt(stmt->label_statement, ops, data);
+		break;
+	case STMT_GOTO:
+		walk_ast_expr(stmt->goto_expression, ops, data);
+		break;
+	default:
+		break;
+	}
+}
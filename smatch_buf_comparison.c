@@ -169,6 +169,9 @@ static void match_alloc_helper(struct expression *pointer, struct expression *si
 	int limit_type = BYTE_COUNT;
 	sval_t sval;
 
+	if (tiered_cheap_pass())
+		return;
+
 	pointer = strip_expr(pointer);
 	size = strip_expr(size);
 	if (!size || !pointer)
@@ -324,6 +327,9 @@ static void match_calloc(const char *fn, struct expression *expr, void *_start_a
 	int limit_type = ELEM_COUNT;
 	sval_t sval;
 
+	if (tiered_cheap_pass())
+		return;
+
 	pointer = strip_expr(expr->left);
 	call = strip_expr(expr->right);
 	arg = get_argument_from_call_expr(call->args, start_arg);
@@ -803,6 +809,9 @@ static void set_param_compare(const char *array_name, struct symbol *array_sym,
 	struct sm_state *tmp;
 	int limit_type;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (strncmp(key, "==$", 3) != 0)
 		return;
 	param = strtol(key + 3, NULL, 10);
@@ -828,6 +837,9 @@ static void set_implied(struct expression *call, struct expression *array_expr,
 	struct sm_state *tmp;
 	int limit_type;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (strncmp(key, "==$", 3) != 0)
 		return;
 	param = strtol(key + 3, NULL, 10);
@@ -977,6 +989,8 @@ static bool match_assign_smaller(struct expression *expr)
 
 static void match_assign(struct expression *expr)
 {
+	if (tiered_cheap_pass())
+		return;
 	if (expr->op != '=')
 		return;
 
@@ -212,6 +212,9 @@ static struct range_list *size_from_db_type(struct expression *expr)
 	int this_file_only = 0;
 	char *name;
 
+	if (expr == cached_type_expr)
+		return clone_rl(cached_type_rl);
+
 	name = get_member_name(expr);
 	if (!name && is_static(expr)) {
 		name = expr_to_var(expr);
@@ -220,26 +223,15 @@ static struct range_list *size_from_db_type(struct expression *expr)
 	if (!name)
 		return NULL;
 
-	if (expr == cached_type_expr)
-		return clone_rl(cached_type_rl);
 	cached_type_expr = expr;
 	cached_type_rl = NULL;
 
-	if (this_file_only) {
-		db_size_rl = NULL;
-		run_sql(db_size_callback, NULL,
-			"select size from function_type_size where type = '%s' and file = %d;",
-			name, get_file_id());
-		cached_type_rl = clone_rl(db_size_rl);
-		return db_size_rl;
-	}
-
-	db_size_rl = NULL;
-	run_sql(db_size_callback, NULL,
-		"select size from type_size where type = '%s';",
-		name);
-	cached_type_rl = clone_rl(db_size_rl);
-	return db_size_rl;
+	if (this_file_only)
+		cached_type_rl = get_file_type_size(name);
+	else
+		cached_type_rl = get_member_type_size(name);
+	free_string(name);
+	return clone_rl(cached_type_rl);
 }
 
 static struct range_list *size_from_db_symbol(struct expression *expr)
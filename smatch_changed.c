@@ -0,0 +1,516 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * With --changed=<patch> or --changed-lines=<ranges> we only look at the
+ * functions a patch touches.  For example:
+ *
+ *	git diff | smatch --changed=- file.c
+ *	smatch --changed-lines=120-135,200 file.c
+ *
+ * A function is changed if one of the lines in its body changed or if it
+ * uses a global whose declaration changed.  The changed functions are
+ * parsed along with the functions in the file which they call and which
+ * call them.  Everything else is skipped, including the fake assignments
+ * for the globals which none of those functions use.  The functions from
+ * other files come from the DB the same as always.
+ *
+ * Only the warnings from the changed functions are printed.  It is the
+ * whole function and not just the changed lines because removing a check
+ * on one line can cause a warning a few lines down.  Changes outside of
+ * the functions and globals, such as to a struct or a macro, are not
+ * mapped to anything so those still need a full run.
+ */
+
+#include "smatch.h"
+
+char *option_changed;
+char *option_changed_lines;
+
+struct line_range {
+	int start, end;
+};
+
+struct changed_file {
+	char *name;
+	struct line_range *ranges;
+	int nr, alloc;
+	struct changed_file *next;
+};
+
+struct changed_walk {
+	int end;
+	struct symbol_list *callees;
+	struct symbol_list *globals;
+};
+
+struct fn_info {
+	struct symbol *sym;
+	int start, end;
+	struct symbol_list *callees;
+	struct symbol_list *globals;
+	bool changed;
+	struct fn_info *next;
+};
+
+static struct changed_file *changed_files;
+static struct changed_file *cur_file;
+static struct fn_info *fn_infos;
+static struct symbol_list *parse_list;
+static struct symbol_list *report_list;
+static struct symbol_list *global_list;
+static struct symbol *silenced_sym;
+static bool silenced_answer;
+
+static struct changed_file *get_changed_file(const char *name)
+{
+	struct changed_file *file;
+
+	for (file = changed_files; file; file = file->next) {
+		if (name == file->name ||
+		    (name && file->name && strcmp(name, file->name) == 0))
+			return file;
+	}
+
+	file = calloc(1, sizeof(*file));
+	if (!file)
+		sm_fatal("out of memory");
+	file->name = name ? alloc_string(name) : NULL;
+	file->next = changed_files;
+	changed_files = file;
+	return file;
+}
+
+static void add_range(struct changed_file *file, int start, int end)
+{
+	struct line_range *last;
+
+	if (file->nr) {
+		last = &file->ranges[file->nr - 1];
+		if (start >= last->start && start <= last->end + 1) {
+			if (end > last->end)
+				last->end = end;
+			return;
+		}
+	}
+
+	if (file->nr == file->alloc) {
+		file->alloc = file->alloc ? file->alloc * 2 : 16;
+		file->ranges = realloc(file->ranges, file->alloc * sizeof(*file->ranges));
+		if (!file->ranges)
+			sm_fatal("out of memory");
+	}
+	file->ranges[file->nr].start = start;
+	file->ranges[file->nr].end = end;
+	file->nr++;
+}
+
+static void parse_changed_lines(char *str)
+{
+	struct changed_file *file;
+	int start, end;
+	char *p = str;
+
+	file = get_changed_file(NULL);
+	while (*p) {
+		start = strtol(p, &p, 10);
+		end = start;
+		if (*p == '-')
+			end = strtol(p + 1, &p, 10);
+		if (start <= 0 || end < start || (*p && *p != ','))
+			sm_fatal("bad --changed-lines=%s", str);
+		add_range(file, start, end);
+		if (*p == ',')
+			p++;
+	}
+}
+
+/*
+ * "+++ b/foo.c" is the name after the patch.  Lines which are added are
+ * changed and so is the line after a line which was removed.
+ */
+static void parse_patch(const char *patch)
+{
+	struct changed_file *file = NULL;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	int cur = 0;
+	char *p;
+	FILE *fp;
+
+	if (strcmp(patch, "-") == 0)
+		fp = stdin;
+	else
+		fp = fopen(patch, "r");
+	if (!fp)
+		sm_fatal("cannot open '%s'", patch);
+
+	while ((len = getline(&line, &size, fp)) != -1) {
+		if (len && line[len - 1] == '\n')
+			line[--len] = '\0';
+
+		if (strncmp(line, "+++ ", 4) == 0) {
+			p = line + 4;
+			if (strncmp(p, "/dev/null", 9) == 0) {
+				file = NULL;
+				continue;
+			}
+			if (strncmp(p, "b/", 2) == 0)
+				p += 2;
+			p[strcspn(p, "\t")] = '\0';
+			file = get_changed_file(p);
+			cur = 0;
+			continue;
+		}
+		if (strncmp(line, "@@ ", 3) == 0) {
+			p = strstr(line, " +");
+			cur = p ? atoi(p + 2) : 0;
+			continue;
+		}
+		if (!file || cur <= 0)
+			continue;
+
+		switch (line[0]) {
+		case '+':
+			add_range(file, cur, cur);
+			cur++;
+			break;
+		case '-':
+			add_range(file, cur, cur);
+			break;
+		case ' ':
+			cur++;
+			break;
+		}
+	}
+
+	free(line);
+	if (fp != stdin)
+		fclose(fp);
+}
+
+void load_changed_lines(void)
+{
+	if (!option_changed && !option_changed_lines)
+		return;
+	if (option_info)
+		sm_fatal("--changed and --changed-lines don't work with --info");
+
+	if (option_changed)
+		parse_patch(option_changed);
+	if (option_changed_lines)
+		parse_changed_lines(option_changed_lines);
+}
+
+static bool changed_mode(void)
+{
+	return option_changed || option_changed_lines;
+}
+
+/* the names in the patch are relative to the top of the tree */
+static bool same_file(const char *a, const char *b)
+{
+	int len_a, len_b;
+
+	while (strncmp(a, "./", 2) == 0)
+		a += 2;
+	while (strncmp(b, "./", 2) == 0)
+		b += 2;
+
+	len_a = strlen(a);
+	len_b = strlen(b);
+	if (len_a < len_b)
+		return same_file(b, a);
+	if (strcmp(a + len_a - len_b, b) != 0)
+		return false;
+	return len_a == len_b || a[len_a - len_b - 1] == '/';
+}
+
+static struct changed_file *find_changed_file(const char *name)
+{
+	struct changed_file *file;
+
+	for (file = changed_files; file; file = file->next) {
+		if (!file->name || same_file(file->name, name))
+			return file;
+	}
+	return NULL;
+}
+
+static bool is_changed(int start, int end)
+{
+	int i;
+
+	if (!cur_file)
+		return false;
+
+	for (i = 0; i < cur_file->nr; i++) {
+		if (cur_file->ranges[i].start <= end &&
+		    cur_file->ranges[i].end >= start)
+			return true;
+	}
+	return false;
+}
+
+static void record_pos(struct changed_walk *w, struct position pos)
+{
+	if (pos.stream == base_file_stream && pos.line > w->end)
+		w->end = pos.line;
+}
+
+static void record_symbol(struct changed_walk *w, struct symbol *sym, bool call)
+{
+	struct symbol *base;
+
+	if (!sym || !(sym->ctype.modifiers & MOD_TOPLEVEL))
+		return;
+
+	base = get_base_type(sym);
+	if (base && base->type == SYM_FN) {
+		if (!call)
+			return;
+		if (sym->definition)
+			sym = sym->definition;
+		add_ptr_list(&w->callees, sym);
+		return;
+	}
+	add_ptr_list(&w->globals, sym);
+}
+
+static void changed_expr(struct expression *expr, void *data)
+{
+	struct changed_walk *w = data;
+
+	record_pos(w, expr->pos);
+
+	if (expr->type == EXPR_SYMBOL)
+		record_symbol(w, expr->symbol, false);
+	else if (expr->type == EXPR_CALL && expr->fn && expr->fn->type == EXPR_SYMBOL)
+		record_symbol(w, expr->fn->symbol, true);
+}
+
+static void changed_stmt(struct statement *stmt, void *data)
+{
+	record_pos(data, stmt->pos);
+}
+
+static void changed_decl(struct symbol *sym, void *data)
+{
+	record_pos(data, sym->pos);
+}
+
+static const struct ast_walk_ops changed_ops = {
+	.expr = changed_expr,
+	.stmt = changed_stmt,
+	.decl = changed_decl,
+};
+
+static bool in_list(struct symbol_list *list, struct symbol *sym)
+{
+	struct symbol *tmp;
+
+	FOR_EACH_PTR(list, tmp) {
+		if (tmp == sym)
+			return true;
+	} END_FOR_EACH_PTR(tmp);
+	return false;
+}
+
+static void add_unique(struct symbol_list **list, struct symbol *sym)
+{
+	if (!in_list(*list, sym))
+		add_ptr_list(list, sym);
+}
+
+static struct fn_info *get_fn_info(struct symbol *sym)
+{
+	struct fn_info *info;
+
+	for (info = fn_infos; info; info = info->next) {
+		if (info->sym == sym)
+			return info;
+	}
+	return NULL;
+}
+
+static void add_function(struct symbol *sym)
+{
+	struct changed_walk w = {};
+	struct symbol *base;
+	struct fn_info *info;
+
+	base = get_base_type(sym);
+	if (!base || (!base->stmt && !base->inline_stmt))
+		return;
+	if (sym->pos.stream != base_file_stream)
+		return;
+
+	w.end = sym->pos.line;
+	walk_ast_stmt(base->stmt, &changed_ops, &w);
+	walk_ast_stmt(base->inline_stmt, &changed_ops, &w);
+
+	info = calloc(1, sizeof(*info));
+	if (!info)
+		sm_fatal("out of memory");
+	info->sym = sym;
+	info->start = sym->pos.line;
+	/* parse_function_body() sets endpos to the closing curly brace */
+	if (sym->endpos.type && sym->endpos.stream == base_file_stream)
+		info->end = sym->endpos.line;
+	else
+		info->end = w.end + 1;
+	info->callees = w.callees;
+	info->globals = w.globals;
+	info->changed = is_changed(info->start, info->end);
+	info->next = fn_infos;
+	fn_infos = info;
+}
+
+/*
+ * The endpos is the end of the declarator so it doesn't include the
+ * initializer.  Take the last line of the initializer instead.
+ */
+static int global_end_line(struct symbol *sym)
+{
+	struct changed_walk w = {};
+
+	w.end = sym->pos.line;
+	if (sym->endpos.type && sym->endpos.stream == base_file_stream)
+		record_pos(&w, sym->endpos);
+	walk_ast_expr(sym->initializer, &changed_ops, &w);
+	free_ptr_list(&w.callees);
+	free_ptr_list(&w.globals);
+	return w.end;
+}
+
+static void free_fn_infos(void)
+{
+	struct fn_info *info;
+
+	while ((info = fn_infos)) {
+		fn_infos = info->next;
+		free_ptr_list(&info->callees);
+		free_ptr_list(&info->globals);
+		free(info);
+	}
+	free_ptr_list(&parse_list);
+	free_ptr_list(&report_list);
+	free_ptr_list(&global_list);
+	silenced_sym = NULL;
+}
+
+static bool uses_changed_global(struct fn_info *info, struct symbol_list *changed_globals)
+{
+	struct symbol *sym;
+
+	FOR_EACH_PTR(info->globals, sym) {
+		if (in_list(changed_globals, sym))
+			return true;
+	} END_FOR_EACH_PTR(sym);
+	return false;
+}
+
+static bool calls_changed_function(struct fn_info *info)
+{
+	struct symbol *sym;
+
+	FOR_EACH_PTR(info->callees, sym) {
+		if (in_list(report_list, sym))
+			return true;
+	} END_FOR_EACH_PTR(sym);
+	return false;
+}
+
+void changed_lines_start_file(struct symbol_list *sym_list)
+{
+	struct symbol_list *changed_globals = NULL;
+	struct fn_info *info, *callee_info;
+	struct symbol *sym, *base;
+
+	if (!changed_mode())
+		return;
+
+	free_fn_infos();
+	cur_file = find_changed_file(get_base_file());
+
+	FOR_EACH_PTR(sym_list, sym) {
+		if (sym->type != SYM_NODE)
+			continue;
+		base = get_base_type(sym);
+		if (base && base->type == SYM_FN) {
+			add_function(sym);
+			continue;
+		}
+		if (sym->pos.stream == base_file_stream &&
+		    is_changed(sym->pos.line, global_end_line(sym)))
+			add_ptr_list(&changed_globals, sym);
+	} END_FOR_EACH_PTR(sym);
+
+	for (info = fn_infos; info; info = info->next) {
+		if (info->changed || uses_changed_global(info, changed_globals))
+			add_ptr_list(&report_list, info->sym);
+	}
+	free_ptr_list(&changed_globals);
+
+	for (info = fn_infos; info; info = info->next) {
+		if (in_list(report_list, info->sym)) {
+			add_unique(&parse_list, info->sym);
+			FOR_EACH_PTR(info->callees, sym) {
+				callee_info = get_fn_info(sym);
+				if (callee_info)
+					add_unique(&parse_list, sym);
+			} END_FOR_EACH_PTR(sym);
+		} else if (calls_changed_function(info)) {
+			add_unique(&parse_list, info->sym);
+		}
+	}
+
+	FOR_EACH_PTR(parse_list, sym) {
+		info = get_fn_info(sym);
+		FOR_EACH_PTR(info->globals, base) {
+			add_unique(&global_list, base);
+		} END_FOR_EACH_PTR(base);
+	} END_FOR_EACH_PTR(sym);
+}
+
+bool changed_lines_skip_function(struct symbol *sym)
+{
+	if (!changed_mode())
+		return false;
+	return !in_list(parse_list, sym);
+}
+
+bool changed_lines_skip_global(struct symbol *sym)
+{
+	if (!changed_mode() || sym->type != SYM_NODE)
+		return false;
+	return !in_list(global_list, sym);
+}
+
+bool changed_lines_silenced(void)
+{
+	if (!changed_mode())
+		return false;
+	if (!cur_func_sym)
+		return true;
+	if (cur_func_sym != silenced_sym) {
+		silenced_sym = cur_func_sym;
+		silenced_answer = !in_list(report_list, cur_func_sym);
+	}
+	return silenced_answer;
+}
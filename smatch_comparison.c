@@ -857,6 +857,9 @@ static void match_preop(struct expression *expr)
 	struct range_list *left, *right;
 	int op;
 
+	if (tiered_cheap_pass())
+		return;
+
 	/*
 	 * This is an important special case.  Say you have:
 	 *
@@ -1402,6 +1405,9 @@ void __comparison_match_condition(struct expression *expr)
 	char *state_name = NULL;
 	int redo, count;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (expr->type != EXPR_COMPARE)
 		return;
 
@@ -1473,6 +1479,9 @@ void add_comparison_var_sym(
 	struct var_sym *vs;
 	char state_name[256];
 
+	if (tiered_cheap_pass())
+		return;
+
 	ignore_mod_expr = mod_expr;
 
 	if (strcmp(left_name, right_name) > 0) {
@@ -1513,6 +1522,9 @@ static void add_comparison(struct expression *left, int comparison, struct expre
 	struct smatch_state *state;
 	char state_name[256];
 
+	if (tiered_cheap_pass())
+		return;
+
 	left_name = chunk_to_var_sym(left, &left_sym);
 	if (!left_name)
 		goto free;
@@ -1731,6 +1743,9 @@ static void match_assign(struct expression *expr)
 {
 	struct expression *right;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (expr->op != '=')
 		return;
 	if (__in_fake_assign || outside_of_function())
@@ -2586,6 +2601,9 @@ void select_caller_info(const char *name, struct symbol *sym, char *value)
 	char right_buf[128];
 	int op, right_param;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (!split_op_param_key(value, &op, &right_param, &right_key))
 		return;
 
@@ -2635,6 +2653,9 @@ static void db_return_comparison(struct expression *expr, int left_param, char *
 	char *right_key;
 	struct var_sym_list *left_vsl = NULL, *right_vsl = NULL;
 
+	if (tiered_cheap_pass())
+		return;
+
 	if (left_param == -1) {
 		if (expr->type != EXPR_ASSIGNMENT)
 			return;
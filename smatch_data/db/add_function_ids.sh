@@ -0,0 +1,105 @@
+#!/bin/bash
+
+# smatch looks up most tables by function name (see get_static_filter()).
+# This adds an integer function_id column to those tables and indexes it
+# instead of the name.  The id is the str_to_llu_hash() of the name so
+# smatch doesn't need to look it up, and the names are saved in
+# hash_string.  It only fills in the missing ids so it can be run again
+# after a table has been rebuilt.
+#
+# The scripts which insert rows don't know about the new column so
+# reload_partial.sh uses --remove to drop it first.  That has to happen after
+# "compress_caller_info.pl --expand" because the caller_info view uses it.
+
+remove=0
+if [ "$1" = "--remove" ] ; then
+    remove=1
+    shift
+fi
+
+db_file=$1
+
+if [ "$db_file" = "" ] ; then
+    echo "usage:  $0 [--remove] <db_file>"
+    exit 1
+fi
+
+# table:the index columns after function_id and static
+tables="return_states:file,return_id,type
+return_summary:file
+caller_info:file,call_id
+caller_info_call:file,rows
+common_caller_info:file,call_id
+call_implies:file,type
+return_implies:file,type"
+
+found=""
+names=""
+for entry in $tables ; do
+    table=${entry%%:*}
+    cols=${entry#*:}
+
+    kind=$(echo "select type from sqlite_master where name = '$table';" | sqlite3 $db_file)
+    if [ "$kind" != "table" ] ; then
+        continue
+    fi
+    has_id=$(echo "select count(*) from pragma_table_info('$table') where name = 'function_id';" | sqlite3 $db_file)
+    if [ "$remove" = "1" ] ; then
+        if [ "$has_id" != "0" ] ; then
+            echo "drop index if exists ${table}_fid_idx; alter table $table drop column function_id;" | sqlite3 $db_file
+        fi
+        continue
+    fi
+    if [ "$has_id" = "0" ] ; then
+        echo "alter table $table add column function_id integer;" | sqlite3 $db_file
+    fi
+
+    found="$found $table:$cols"
+    if [ "$names" != "" ] ; then
+        names="$names union "
+    fi
+    names="${names}select function from $table where function_id is null"
+done
+
+if [ "$found" = "" ] ; then
+    exit 0
+fi
+
+view=$(echo "select sql from sqlite_master where name = 'caller_info' and type = 'view';" | sqlite3 $db_file)
+
+{
+    echo "PRAGMA synchronous = OFF;"
+    echo "PRAGMA cache_size = 800000;"
+    echo "PRAGMA journal_mode = OFF;"
+    echo "PRAGMA temp_store = MEMORY;"
+    echo "PRAGMA locking = EXCLUSIVE;"
+    echo "BEGIN;"
+    echo "CREATE TEMP TABLE function_ids (name text primary key, id integer);"
+
+    # the same hash as str_to_llu_hash_helper()
+    echo "$names;" | sqlite3 $db_file | perl -MDigest::SHA=sha1 -ne '
+        chomp;
+        next if ($_ eq "");
+        my ($lo, $hi) = unpack("VV", sha1($_));
+        my $id = (($hi & 0x7fffffff) << 32) | $lo;
+        s/\x27/\x27\x27/g;
+        print "INSERT OR IGNORE INTO function_ids VALUES (\x27$_\x27, $id);\n";'
+
+    for entry in $found ; do
+        table=${entry%%:*}
+        cols=${entry#*:}
+        echo "UPDATE $table SET function_id = (SELECT id FROM function_ids WHERE name = $table.function) WHERE function_id IS NULL;"
+        echo "CREATE INDEX IF NOT EXISTS ${table}_fid_idx ON $table (function_id, static, $cols);"
+    done
+    echo "INSERT OR IGNORE INTO hash_string SELECT id, name FROM function_ids;"
+
+    # These tables are rebuilt from scratch so nothing else needs the names.
+    echo "DROP INDEX IF EXISTS return_summary_fn_idx;"
+    echo "DROP INDEX IF EXISTS caller_call_fn_idx;"
+
+    if [ "$view" != "" ] && ! echo "$view" | grep -q function_id ; then
+        echo "DROP VIEW caller_info;"
+        echo "$view;" | sed -e 's/c\.function as function,/c.function as function, c.function_id as function_id,/'
+    fi
+    echo "COMMIT;"
+} | sqlite3 $db_file > /dev/null
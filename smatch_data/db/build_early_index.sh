@@ -11,13 +11,15 @@ PRAGMA count_changes = OFF;
 PRAGMA temp_store = MEMORY;
 PRAGMA locking = EXCLUSIVE;
 
-CREATE INDEX caller_fn_idx on caller_info (function, call_id);
+-- get_static_filter() looks up static functions with "function = 'x' and
+-- static = 1 and file = y" and the rest with "function = 'x' and static = 0".
+-- The *_fn_idx indexes start with those columns so both are a single seek.
+-- For call_implies and return_implies the UNIQUE constraint does that.
+CREATE INDEX caller_fn_idx on caller_info (function, static, file, call_id);
 CREATE INDEX caller_ff_idx on caller_info (file, function, call_id);
-CREATE INDEX common_fn_idx on common_caller_info (function, call_id);
+CREATE INDEX common_fn_idx on common_caller_info (function, static, file, call_id);
 CREATE INDEX common_ff_idx on common_caller_info (file, function, call_id);
-CREATE INDEX call_implies_fn_idx on call_implies (function);
 CREATE INDEX call_implies_ff_idx on call_implies (file, function);
-CREATE INDEX return_implies_fn_idx on return_implies (function);
 CREATE INDEX return_implies_ff_idx on return_implies (file, function);
 CREATE INDEX data_file_info_idx on data_info (file, data);
 CREATE INDEX data_info_idx on data_info (data);
@@ -29,7 +31,7 @@ CREATE INDEX function_type_idx on function_type (function);
 CREATE INDEX function_type_size_idx ON function_type_size (type);
 CREATE INDEX function_type_value_idx ON function_type_value (type);
 CREATE INDEX local_value_idx on local_values (file, variable);
-CREATE INDEX return_states_fn_idx on return_states (function);
+CREATE INDEX return_states_fn_idx on return_states (function, static, file, return_id, type);
 CREATE INDEX return_states_ff_idx on return_states (file, function);
 CREATE INDEX parameter_name_file_idx on parameter_name (file, function);
 CREATE INDEX parameter_name_idx on parameter_name (function);
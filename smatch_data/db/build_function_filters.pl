@@ -0,0 +1,90 @@
+#!/usr/bin/perl -w
+
+# Most calls go to functions which don't have any return_states or
+# implies rows at all.  This saves a Bloom filter of the functions which
+# do have rows so smatch can skip the queries which are going to come back
+# empty.  The hashing has to match db_function_has_rows() in smatch_db.c.
+
+use strict;
+use warnings;
+use DBI qw(:sql_types);
+use DBD::SQLite;
+
+my $db_file = shift;
+
+if (!defined($db_file)) {
+    print "usage:  $0 <db_file>\n";
+    exit(1);
+}
+
+my $db = DBI->connect("dbi:SQLite:$db_file", "", "", {AutoCommit => 0});
+$db->do("PRAGMA cache_size = 800000");
+$db->do("PRAGMA journal_mode = OFF");
+$db->do("PRAGMA count_changes = OFF");
+$db->do("PRAGMA temp_store = MEMORY");
+$db->do("PRAGMA locking = EXCLUSIVE");
+
+my $HASHES = 4;
+
+sub fnv1a {
+    use integer;
+    my $str = shift;
+    my $hash = 2166136261;
+
+    foreach my $c (unpack("C*", $str)) {
+        $hash ^= $c;
+        $hash = ($hash * 16777619) & 0xffffffff;
+    }
+    return $hash;
+}
+
+sub djb2 {
+    use integer;
+    my $str = shift;
+    my $hash = 5381;
+
+    foreach my $c (unpack("C*", $str)) {
+        $hash = (($hash << 5) + $hash + $c) & 0xffffffff;
+    }
+    return $hash;
+}
+
+$db->do("delete from function_filter;");
+my $insert = $db->prepare("insert into function_filter values (?, ?, ?, ?);");
+
+foreach my $table ("return_states", "call_implies", "return_implies") {
+    my @keys;
+    my $sth = $db->prepare("select distinct file, function, static from $table;");
+    $sth->execute();
+    while (my ($file, $function, $static) = $sth->fetchrow_array()) {
+        if ($static) {
+            push @keys, "$file $function";
+        } else {
+            push @keys, $function;
+        }
+    }
+
+    # about 10 bits per function gives a false positive rate around 1%
+    my $bits = 1024;
+    while ($bits < scalar(@keys) * 10) {
+        $bits *= 2;
+    }
+
+    my $filter = "\0" x ($bits / 8);
+    foreach my $key (@keys) {
+        my $h1 = fnv1a($key);
+        my $h2 = djb2($key);
+        for (my $i = 0; $i < $HASHES; $i++) {
+            vec($filter, ($h1 + $i * $h2) % $bits, 1) = 1;
+        }
+    }
+
+    $insert->bind_param(1, $table);
+    $insert->bind_param(2, $bits);
+    $insert->bind_param(3, $HASHES);
+    $insert->bind_param(4, $filter, SQL_BLOB);
+    $insert->execute();
+}
+
+$db->commit();
+$db->disconnect();
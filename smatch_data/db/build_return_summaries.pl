@@ -0,0 +1,67 @@
+#!/usr/bin/perl -w
+
+# Pack the return_states rows for each function into a single blob.  Each
+# row is return_id, return, type, parameter, key and value, with every
+# field NUL terminated, in the same order that sql_select_return_states()
+# used to select them.  The return_states table is left alone for tools.
+
+use strict;
+use warnings;
+use DBI qw(:sql_types);
+
+my $db_file = shift;
+
+if (!defined($db_file)) {
+    print "usage:  $0 <db_file>\n";
+    exit(1);
+}
+
+my $db = DBI->connect("dbi:SQLite:$db_file", "", "", {AutoCommit => 0});
+$db->do("PRAGMA cache_size = 800000");
+$db->do("PRAGMA journal_mode = OFF");
+$db->do("PRAGMA count_changes = OFF");
+$db->do("PRAGMA temp_store = MEMORY");
+$db->do("PRAGMA locking = EXCLUSIVE");
+
+$db->do("delete from return_summary;");
+my $insert = $db->prepare("insert into return_summary values (?, ?, ?, ?, ?);");
+
+my $sth = $db->prepare("select file, function, static, return_id, return, type, parameter, key, value from return_states order by file, function, static, return_id, type, rowid;");
+$sth->execute();
+
+my ($cur_file, $cur_function, $cur_static);
+my $rows = 0;
+my $summary = "";
+
+sub save_summary {
+    if (!$rows) {
+        return;
+    }
+    $insert->bind_param(1, $cur_file);
+    $insert->bind_param(2, $cur_function);
+    $insert->bind_param(3, $cur_static);
+    $insert->bind_param(4, $rows);
+    $insert->bind_param(5, $summary, SQL_BLOB);
+    $insert->execute();
+    $rows = 0;
+    $summary = "";
+}
+
+while (my @row = $sth->fetchrow_array()) {
+    my ($file, $function, $static, @fields) = @row;
+
+    if (!defined($cur_file) || $file ne $cur_file ||
+        $function ne $cur_function || $static ne $cur_static) {
+        save_summary();
+        ($cur_file, $cur_function, $cur_static) = ($file, $function, $static);
+    }
+
+    foreach my $field (@fields) {
+        $summary .= (defined($field) ? $field : "") . "\0";
+    }
+    $rows++;
+}
+save_summary();
+
+$db->commit();
+$db->disconnect();
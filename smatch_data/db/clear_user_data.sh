@@ -6,6 +6,10 @@ if [ "$dir" = "" ] ; then
     exit 1
 fi
 
+bin_dir=$(dirname $0)
+${bin_dir}/compress_caller_info.pl --expand smatch_db.sqlite
+${bin_dir}/add_function_ids.sh --remove smatch_db.sqlite
+
 USER_TYPE="(type = 8017 or (type >= 9017 and type <= 9019))"
 HOST_TYPE="(type >= 7016 and type <= 7019)"
 
@@ -17,4 +21,6 @@ else
     echo "delete from return_states where ${USER_TYPE} or ${HOST_TYPE} or type = 9018) and file like '$dir%';" | sqlite3 smatch_db.sqlite
 fi
 
-
+${bin_dir}/build_return_summaries.pl smatch_db.sqlite
+${bin_dir}/compress_caller_info.pl smatch_db.sqlite
+${bin_dir}/add_function_ids.sh smatch_db.sqlite
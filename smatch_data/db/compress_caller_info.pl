@@ -0,0 +1,153 @@
+#!/usr/bin/perl -w
+
+# caller_info is the biggest table in the DB.  Most of it is the same keys
+# and range strings over and over, and a lot of call sites pass exactly the
+# same information.  This splits it into:
+#
+#   caller_info_string: every key and value string, stored once
+#   caller_info_rows:   the type, parameter, key and value rows for a call
+#                       site, shared by all the call sites with the same rows
+#   caller_info_call:   one row per call site which points to its rows
+#
+# caller_info is replaced with a view so the scripts which read it still
+# work.  The view can't be changed so use --expand to turn it back into a
+# table first.
+
+use strict;
+use warnings;
+use DBI;
+use Digest::MD5 qw(md5);
+
+my $expand = 0;
+if (defined($ARGV[0]) && $ARGV[0] eq "--expand") {
+    $expand = 1;
+    shift;
+}
+my $db_file = shift;
+
+if (!defined($db_file)) {
+    print "usage:  $0 [--expand] <db_file>\n";
+    exit(1);
+}
+
+my $db = DBI->connect("dbi:SQLite:$db_file", "", "", {AutoCommit => 0});
+$db->do("PRAGMA cache_size = 800000");
+$db->do("PRAGMA journal_mode = OFF");
+$db->do("PRAGMA count_changes = OFF");
+$db->do("PRAGMA temp_store = MEMORY");
+$db->do("PRAGMA locking = EXCLUSIVE");
+
+my ($kind) = $db->selectrow_array("select type from sqlite_master where name = 'caller_info';");
+if (!defined($kind)) {
+    print "$0: no caller_info in $db_file\n";
+    exit(1);
+}
+
+my $joined = "from caller_info_call c
+              join caller_info_rows r on r.rows = c.rows
+              left join caller_info_string k on k.id = r.key
+              left join caller_info_string v on v.id = r.value";
+
+if ($expand) {
+    if ($kind eq "table") {
+        exit(0);
+    }
+    $db->do("drop view caller_info;");
+    $db->do("CREATE TABLE caller_info (file big int, caller varchar(64), function varchar(64), call_id integer, static boolean, type integer, parameter integer, key varchar(256), value varchar(256));");
+    $db->do("insert into caller_info select c.file, c.caller, c.function, c.call_id, c.static, r.type, r.parameter, k.str, v.str $joined order by c.call_id, c.rowid, r.idx;");
+    $db->do("drop table caller_info_call;");
+    $db->do("drop table caller_info_rows;");
+    $db->do("drop table caller_info_string;");
+    $db->do("CREATE INDEX caller_fn_idx on caller_info (function, static, file, call_id);");
+    $db->do("CREATE INDEX caller_ff_idx on caller_info (file, function, call_id);");
+    $db->commit();
+    $db->disconnect();
+    exit(0);
+}
+
+if ($kind ne "table") {
+    exit(0);
+}
+
+$db->do("CREATE TABLE caller_info_string (id integer primary key, str text);");
+$db->do("CREATE TABLE caller_info_rows (rows integer, idx integer, type integer, parameter integer, key integer, value integer, primary key (rows, idx)) without rowid;");
+$db->do("CREATE TABLE caller_info_call (file big int, caller varchar(64), function varchar(64), call_id integer, static boolean, rows integer);");
+
+my $insert_string = $db->prepare("insert into caller_info_string values (?, ?);");
+my $insert_row = $db->prepare("insert into caller_info_rows values (?, ?, ?, ?, ?, ?);");
+my $insert_call = $db->prepare("insert into caller_info_call values (?, ?, ?, ?, ?, ?);");
+
+my %strings;
+my $nr_strings = 0;
+
+sub string_id($)
+{
+    my $str = shift;
+
+    if (!defined($str)) {
+        return undef;
+    }
+    if (!exists($strings{$str})) {
+        $strings{$str} = ++$nr_strings;
+        $insert_string->execute($nr_strings, $str);
+    }
+    return $strings{$str};
+}
+
+# The rows are kept in the order they were inserted because the later ones
+# win if two of them set the same state.
+my %groups;
+my $nr_groups = 0;
+my @site;
+my @rows;
+
+sub save_site()
+{
+    my ($sig, $group, $idx);
+
+    if (!@site) {
+        return;
+    }
+
+    $sig = md5(join("\n", map { join(",", map { defined($_) ? $_ : "" } @$_) } @rows));
+    $group = $groups{$sig};
+    if (!defined($group)) {
+        $group = $groups{$sig} = ++$nr_groups;
+        $idx = 0;
+        foreach my $row (@rows) {
+            $insert_row->execute($group, $idx++, @$row);
+        }
+    }
+    $insert_call->execute(@site, $group);
+
+    @site = ();
+    @rows = ();
+}
+
+my $sth = $db->prepare("select file, caller, function, call_id, static, type, parameter, key, value from caller_info order by call_id, file, caller, function, static, rowid;");
+$sth->execute();
+
+while (my @row = $sth->fetchrow_array()) {
+    my ($file, $caller, $function, $call_id, $static, $type, $param, $key, $value) = @row;
+    my @new_site = ($file, $caller, $function, $call_id, $static);
+
+    if (!@site || join("\0", map { defined($_) ? $_ : "" } @site) ne
+                  join("\0", map { defined($_) ? $_ : "" } @new_site)) {
+        save_site();
+        @site = @new_site;
+    }
+    push @rows, [$type, $param, string_id($key), string_id($value)];
+}
+save_site();
+
+$db->do("drop table caller_info;");
+$db->do("CREATE VIEW caller_info AS select c.file as file, c.caller as caller, c.function as function, c.call_id as call_id, c.static as static, r.type as type, r.parameter as parameter, k.str as key, v.str as value $joined;");
+$db->do("CREATE INDEX caller_call_fn_idx on caller_info_call (function, static, file, rows);");
+$db->do("CREATE INDEX caller_call_ff_idx on caller_info_call (file, function, rows);");
+$db->do("CREATE INDEX caller_call_id_idx on caller_info_call (call_id);");
+$db->commit();
+
+# give the space back
+$db->{AutoCommit} = 1;
+$db->do("VACUUM;");
+$db->disconnect();
@@ -36,6 +36,9 @@ ${bin_dir}/fill_db_caller_info.pl "$PROJ" $info_file $db_file
 if [ -e ${info_file}.caller_info ] ; then
     ${bin_dir}/fill_db_caller_info.pl "$PROJ" ${info_file}.caller_info $db_file
 fi
+if [ -e ${info_file}.shards ] ; then
+    ${bin_dir}/merge_db_shards.sh -p=$PROJ $db_file < ${info_file}.shards
+fi
 ${bin_dir}/build_early_index.sh $db_file
 
 ${bin_dir}/fill_db_type_value.pl "$PROJ" $info_file $db_file
@@ -61,6 +64,11 @@ if [ "$PROJ" != "" ] ; then
     ${bin_dir}/insert_manual_states.pl ${PROJ} $db_file
 fi
 
+${bin_dir}/build_function_filters.pl $db_file
+${bin_dir}/build_return_summaries.pl $db_file
+${bin_dir}/compress_caller_info.pl $db_file
+${bin_dir}/add_function_ids.sh $db_file
+
 # test the new DB
 if ! echo "select * from return_states where type = 0 limit 1;" | \
     sqlite3 $db_file > /dev/null ; then
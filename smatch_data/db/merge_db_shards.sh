@@ -0,0 +1,160 @@
+#!/bin/bash
+#
+# Merges the file.c.smatch.db shards from "smatch --info --db-shard" into a
+# DB.  The shards are split into one group per CPU and each group is merged
+# into a temporary DB in parallel.  Then the temporary DBs are merged into
+# the real DB.
+#
+# The shards are listed on the command line or one per line on stdin.  With
+# --replace the rows from the files in the shard are deleted first so a
+# re-analyzed file can be reloaded on its own.  That only works for the
+# tables which have a file column.  The other tables, like type_size and
+# type_value, hold facts gathered from every file so there is no way to
+# tell which rows came from the old run.  New rows are added to those but
+# the stale rows stay until the DB is rebuilt.
+
+usage()
+{
+    echo "usage: $0 [-p=<project>] [-j <jobs>] [--replace] <db_file> [shards...]"
+    exit 1
+}
+
+if echo $1 | grep -q '^-p' ; then
+    PROJ=$(echo $1 | cut -d = -f 2)
+    shift
+fi
+
+JOBS=$(nproc 2> /dev/null || echo 1)
+if [ "$1" == "-j" ] ; then
+    JOBS=$2
+    shift 2
+fi
+
+REPLACE=0
+if [ "$1" == "--replace" ] ; then
+    REPLACE=1
+    shift
+fi
+
+db_file=$1
+if [ "$db_file" == "" ] ; then
+    usage
+fi
+shift
+
+bin_dir=$(dirname $0)
+tmp_dir=$(mktemp -d)
+trap "rm -rf $tmp_dir" EXIT
+
+if [ $# -gt 0 ] ; then
+    printf "%s\n" "$@" > $tmp_dir/shards
+else
+    grep -v '^$' > $tmp_dir/shards
+fi
+
+nr_shards=$(wc -l < $tmp_dir/shards)
+if [ $nr_shards -eq 0 ] ; then
+    exit 0
+fi
+if [ $JOBS -gt $nr_shards ] ; then
+    JOBS=$nr_shards
+fi
+
+# All the shards are created by the same smatch so they have the same tables
+tables=$(echo "select name from sqlite_master where type = 'table';" | \
+	 sqlite3 $(head -n 1 $tmp_dir/shards))
+file_tables=$(echo "select m.name from sqlite_master m, pragma_table_info(m.name) p
+		    where m.type = 'table' and p.name = 'file';" | \
+	      sqlite3 $(head -n 1 $tmp_dir/shards))
+
+if [ $REPLACE -eq 1 ] ; then
+    for table in $tables ; do
+	if ! echo "$file_tables" | grep -qx "$table" ; then
+	    echo "$0: --replace: $table has no file column, old rows are kept" >&2
+	fi
+    done
+fi
+
+# The call_ids in a shard start from 1 so they are moved past the end of
+# the caller_info table.  Everything else is copied as is.
+merge_sql()
+{
+    local shard
+
+    echo "PRAGMA synchronous = OFF;"
+    echo "PRAGMA journal_mode = OFF;"
+    echo "PRAGMA temp_store = MEMORY;"
+    while read shard ; do
+	echo "ATTACH '$shard' AS shard;"
+	echo "BEGIN;"
+	if [ $REPLACE -eq 1 ] ; then
+	    # A table can be empty for a file in the new run so the files
+	    # are collected from every table in the shard
+	    echo "CREATE TEMP TABLE shard_files AS"
+	    sep="   "
+	    for table in $file_tables ; do
+		echo " $sep SELECT file FROM shard.$table"
+		sep="UNION"
+	    done
+	    echo ";"
+	    for table in $file_tables ; do
+		echo "DELETE FROM main.$table WHERE file IN (SELECT file FROM temp.shard_files);"
+	    done
+	    echo "DROP TABLE temp.shard_files;"
+	fi
+	for table in $tables ; do
+	    if [ "$table" == "caller_info" ] ; then
+		echo "INSERT INTO main.caller_info SELECT file, caller, function, call_id +"
+		echo "    (SELECT ifnull(max(call_id), 0) FROM main.caller_info),"
+		echo "    static, type, parameter, key, value FROM shard.caller_info;"
+	    else
+		echo "INSERT OR IGNORE INTO main.$table SELECT * FROM shard.$table;"
+	    fi
+	done
+	echo "COMMIT;"
+	echo "DETACH shard;"
+    done
+}
+
+# Split the shards into groups and merge each group into the first shard of
+# the group.  The first shard is copied so the shards themselves aren't
+# changed.
+awk -v jobs=$JOBS -v dir=$tmp_dir '{ print > (dir "/group." (NR - 1) % jobs) }' $tmp_dir/shards
+for group in $tmp_dir/group.* ; do
+    (
+	part=$group.db
+	cp "$(head -n 1 $group)" $part
+	tail -n +2 $group | REPLACE=0 merge_sql | sqlite3 $part > /dev/null
+    ) &
+done
+wait
+
+ls $tmp_dir/group.*.db | merge_sql | sqlite3 $db_file > /dev/null
+
+# This is the set based version of what fill_db_caller_info.pl does to the
+# SQL_caller_info lines.
+cat << EOF | sqlite3 $db_file > /dev/null
+PRAGMA synchronous = OFF;
+PRAGMA journal_mode = OFF;
+PRAGMA temp_store = MEMORY;
+
+BEGIN;
+CREATE TEMP TABLE too_common AS
+    SELECT function FROM caller_info WHERE type = 0 AND key = '%call_marker%'
+    GROUP BY function HAVING count(*) > 200;
+INSERT INTO common_caller_info
+    SELECT 'unknown', 'too common', function, 0, 0, 0, -1, '', '' FROM too_common
+    WHERE function NOT IN (SELECT function FROM common_caller_info WHERE caller = 'too common');
+DELETE FROM caller_info WHERE instr(function, '__builtin_') OR
+    function IN ('printk', 'memset', 'memcpy', 'kfree', 'printf', 'dev_err', 'writel');
+UPDATE caller_info SET key = '' WHERE type = 0 AND key = '%call_marker%';
+COMMIT;
+EOF
+
+if [ "$PROJ" != "" ] ; then
+    common_file=${bin_dir}/../${PROJ}.common_functions
+    ( test -e $common_file && cat $common_file
+      echo "select function from common_caller_info where caller = 'too common' and function not like '% %';" | \
+	  sqlite3 $db_file ) | sort -u > $tmp_dir/common_functions
+    cp $tmp_dir/common_functions $common_file
+fi
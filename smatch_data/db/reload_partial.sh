@@ -9,39 +9,52 @@ info_file=$1
 
 if [[ "$info_file" = "" ]] ; then
     echo "Usage:  $0 -p=<project> <file with smatch messages>"
+    echo "        $0 -p=<project> <file.c.smatch.db>..."
     exit 1
 fi
 
 bin_dir=$(dirname $0)
 db_file=smatch_db.sqlite
 
-files=$(grep "insert into caller_info" $info_file | cut -d : -f 1 | sort -u)
-for c_file in $files; do
-    echo "FILE $c_file"
-    echo "delete from caller_info where file = '$c_file';" | sqlite3 $db_file
-    echo "delete from return_states where file = '$c_file';" | sqlite3 $db_file
-    echo "delete from call_implies where file = '$c_file';" | sqlite3 $db_file
-    echo "delete from return_implies where file = '$c_file';" | sqlite3 $db_file
-done
+${bin_dir}/compress_caller_info.pl --expand $db_file
+${bin_dir}/add_function_ids.sh --remove $db_file
 
-tmp_file=$(mktemp)
+if echo $info_file | grep -q '\.smatch\.db$' ; then
+    # the shards replace everything for their files in one go
+    ${bin_dir}/merge_db_shards.sh -p=$PROJ --replace $db_file "$@"
+else
+    files=$(grep "insert into caller_info" $info_file | cut -d : -f 1 | sort -u)
+    for c_file in $files; do
+	echo "FILE $c_file"
+	echo "delete from caller_info where file = '$c_file';" | sqlite3 $db_file
+	echo "delete from return_states where file = '$c_file';" | sqlite3 $db_file
+	echo "delete from call_implies where file = '$c_file';" | sqlite3 $db_file
+	echo "delete from return_implies where file = '$c_file';" | sqlite3 $db_file
+    done
 
-grep "insert into caller_info" $info_file > $tmp_file
-${bin_dir}/fill_db_caller_info.pl "$PROJ" $tmp_file $db_file
+    tmp_file=$(mktemp)
 
-grep "insert into return_states" $info_file > $tmp_file
-${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
+    grep "insert into caller_info" $info_file > $tmp_file
+    ${bin_dir}/fill_db_caller_info.pl "$PROJ" $tmp_file $db_file
 
-grep "into call_implies" $info_file > $tmp_file
-${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
+    grep "insert into return_states" $info_file > $tmp_file
+    ${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
 
-grep "into return_implies" $info_file > $tmp_file
-${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
+    grep "into call_implies" $info_file > $tmp_file
+    ${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
 
-rm $tmp_file
+    grep "into return_implies" $info_file > $tmp_file
+    ${bin_dir}/fill_db_sql.pl "$PROJ" $tmp_file $db_file
+
+    rm $tmp_file
+fi
 
 ${bin_dir}/fixup_all.sh $db_file
 if [ "$PROJ" != "" ] ; then
     ${bin_dir}/fixup_${PROJ}.sh $db_file
 fi
 
+${bin_dir}/build_function_filters.pl $db_file
+${bin_dir}/build_return_summaries.pl $db_file
+${bin_dir}/compress_caller_info.pl $db_file
+${bin_dir}/add_function_ids.sh $db_file
@@ -0,0 +1,55 @@
+#!/usr/bin/perl -w
+
+# Converts the output of "smatch --info --info-frames" back to the text
+# format which the other scripts expect.  It reads the files given on the
+# command line or stdin.  See smatch_info_frames.c.
+
+use strict;
+use open IO => ":raw";
+
+my %kinds = (
+    'S' => 'SQL',
+    'L' => 'SQL_late',
+    'C' => 'SQL_caller_info',
+);
+
+binmode(STDIN);
+binmode(STDOUT);
+
+my $file = "";
+my $function = "";
+
+while (my $line = <>) {
+    if (substr($line, 0, 1) ne "\x1e") {
+        print $line;
+        next;
+    }
+
+    if (!($line =~ /^\x1e([FSLC])(\d+):/)) {
+        die "$0: bad record: $line";
+    }
+    my $type = $1;
+    my $len = $2;
+    my $data = substr($line, length($&));
+
+    # the payload can contain newlines
+    while (length($data) < $len + 1) {
+        my $more = <>;
+        if (!defined($more)) {
+            die "$0: truncated record\n";
+        }
+        $data .= $more;
+    }
+    if (substr($data, $len) ne "\n") {
+        die "$0: bad record length: $line";
+    }
+    $data = substr($data, 0, $len);
+
+    if ($type eq 'F') {
+        ($file, $function) = split(/\0/, $data, 2);
+        next;
+    }
+
+    my ($lineno, $sql) = split(/ /, $data, 2);
+    print "$file:$lineno $function() $kinds{$type}: $sql\n";
+}
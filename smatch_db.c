@@ -19,6 +19,8 @@
 #include <errno.h>
 #include <unistd.h>
 #include <ctype.h>
+#include <pthread.h>
+#include <time.h>
 #include "smatch.h"
 #include "smatch_slist.h"
 #include "smatch_extra.h"
@@ -26,6 +28,7 @@
 struct sqlite3 *smatch_db;
 struct sqlite3 *mem_db;
 struct sqlite3 *cache_db;
+struct sqlite3 *shard_db;
 
 int debug_db;
 
@@ -33,6 +36,7 @@ STATE(incomplete);
 static int my_id;
 
 static int return_id;
+static int shard_call_id;
 
 static void call_return_state_hooks(struct expression *expr);
 static void call_return_states_callbacks(const char *return_ranges, struct expression *expr);
@@ -151,6 +155,131 @@ static int print_sql_output(void *unused, int argc, char **argv, char **azColNam
 	return 0;
 }
 
+/*
+ * Rows for the in-memory databases are queued up here instead of being
+ * inserted one at a time.  Each sqlite3_exec() insert is its own
+ * transaction and we do a lot of them when we're parsing inlines.  The
+ * queue is flushed inside a single transaction before anything else
+ * touches that database.
+ */
+struct sql_batch {
+	char *buf;
+	size_t len;
+	size_t size;
+	int rows;
+};
+static struct sql_batch mem_batch, cache_batch, shard_batch;
+
+static struct sql_batch *get_sql_batch(struct sqlite3 *db)
+{
+	if (!db)
+		return NULL;
+	if (db == mem_db)
+		return &mem_batch;
+	if (db == cache_db)
+		return &cache_batch;
+	if (db == shard_db)
+		return &shard_batch;
+	return NULL;
+}
+
+static void sql_batch_append(struct sql_batch *batch, const char *fmt, va_list args)
+{
+	va_list tmp;
+	int len;
+
+	va_copy(tmp, args);
+	len = vsnprintf(NULL, 0, fmt, tmp);
+	va_end(tmp);
+	if (len < 0)
+		return;
+
+	if (batch->len + len + 1 > batch->size) {
+		batch->size = batch->size ? batch->size : 4096;
+		while (batch->len + len + 1 > batch->size)
+			batch->size *= 2;
+		batch->buf = realloc(batch->buf, batch->size);
+		if (!batch->buf)
+			sm_fatal("out of memory queuing SQL");
+	}
+	vsnprintf(batch->buf + batch->len, batch->size - batch->len, fmt, args);
+	batch->len += len;
+}
+
+static void sql_batch_printf(struct sql_batch *batch, const char *fmt, ...)
+{
+	va_list args;
+
+	va_start(args, fmt);
+	sql_batch_append(batch, fmt, args);
+	va_end(args);
+}
+
+void sql_queue_insert(struct sqlite3 *db, const char *ignore, const char *table, const char *values, ...)
+{
+	struct sql_batch *batch;
+	va_list args;
+	size_t start;
+
+	batch = get_sql_batch(db);
+	if (!batch)
+		return;
+
+	start = batch->len;
+	sql_batch_printf(batch, "insert %sinto %s values (", ignore, table);
+	va_start(args, values);
+	sql_batch_append(batch, values, args);
+	va_end(args);
+	sql_batch_printf(batch, ");\n");
+	batch->rows++;
+
+	db_debug("mem-db: %s", batch->buf + start);
+	fn_cache_add_insert(db, batch->buf + start);
+
+	/* shards are only read after we exit so don't let them pile up */
+	if (db == shard_db && batch->rows >= 1000)
+		sql_flush_batch(db);
+}
+
+void sql_flush_batch(struct sqlite3 *db)
+{
+	struct sql_batch *batch;
+	struct sqlite3_stmt *stmt;
+	const char *sql, *tail;
+	int rc;
+
+	batch = get_sql_batch(db);
+	if (!batch || !batch->rows)
+		return;
+
+	sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+	sql = batch->buf;
+	while (*sql) {
+		rc = sqlite3_prepare_v2(db, sql, -1, &stmt, &tail);
+		if (rc != SQLITE_OK) {
+			sm_ierror("SQL error #2: %s", sqlite3_errmsg(db));
+			sm_ierror("SQL: '%.*s'", (int)(tail - sql), sql);
+			parse_error = 1;
+		} else if (stmt) {
+			rc = sqlite3_step(stmt);
+			if (rc != SQLITE_DONE) {
+				sm_ierror("SQL error #2: %s", sqlite3_errmsg(db));
+				sm_ierror("SQL: '%s'", sqlite3_sql(stmt));
+				parse_error = 1;
+			}
+			sqlite3_finalize(stmt);
+		}
+		if (tail == sql)
+			break;
+		sql = tail;
+	}
+	sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+	batch->len = 0;
+	batch->rows = 0;
+	batch->buf[0] = '\0';
+}
+
 void sql_exec(struct sqlite3 *db, int (*callback)(void*, int, char**, char**), void *data, const char *sql)
 {
 	char *err = NULL;
@@ -159,13 +288,18 @@ void sql_exec(struct sqlite3 *db, int (*callback)(void*, int, char**, char**), v
 	if (!db)
 		return;
 
+	sql_flush_batch(db);
+
 	if (option_debug || debug_db) {
 		sm_msg("%s", sql);
 		if (strncasecmp(sql, "select", strlen("select")) == 0)
 			sqlite3_exec(db, sql, print_sql_output, NULL, NULL);
 	}
 
-	rc = sqlite3_exec(db, sql, callback, data, &err);
+	if (fn_cache_recording(db))
+		rc = fn_cache_exec(db, sql, callback, data, &err);
+	else
+		rc = sqlite3_exec(db, sql, callback, data, &err);
 	if (rc != SQLITE_OK && !parse_error) {
 		sm_ierror("%s:%d SQL error #2: %s\n", get_filename(), get_lineno(), err);
 		sm_ierror("%s:%d SQL: '%s'\n", get_filename(), get_lineno(), sql);
@@ -284,6 +418,17 @@ static void set_fn_mtag(struct symbol *sym)
 	__fn_mtag = str_to_mtag(buf);
 }
 
+/* the function cache uses these when it replays an inline */
+int get_return_id(void)
+{
+	return return_id;
+}
+
+void skip_return_ids(int count)
+{
+	return_id += count;
+}
+
 void sql_insert_return_states(int return_id, const char *return_ranges,
 		int type, int param, const char *key, const char *value)
 {
@@ -329,7 +474,6 @@ static char *function_signature(void)
 void sql_insert_caller_info(struct expression *call, int type,
 		int param, const char *key, const char *value)
 {
-	FILE *tmp_fd = sm_outfd;
 	char *fn;
 
 	if (!option_info && !__inline_call)
@@ -359,13 +503,25 @@ void sql_insert_caller_info(struct expression *call, int type,
 	if (type != INTERNAL && is_common_function(fn))
 		return;
 
-	sm_outfd = caller_info_fd;
-	sm_msg("SQL_caller_info: insert into caller_info values ("
-	       "0x%llx, '%s', '%s', %%CALL_ID%%, %d, %d, %d, '%s', '%s');",
-	       get_base_file_id(), get_function(), fn, is_static(call->fn),
-	       type, param, key, value);
-	sm_outfd = tmp_fd;
+	if (shard_db) {
+		/* these were printed with sm_msg() so they follow its rules */
+		if (!final_pass || __silence_warnings_for_stmt)
+			goto free;
+		if (strcmp(key, "%call_marker%") == 0)
+			shard_call_id++;
+		sql_queue_insert(shard_db, "", "caller_info",
+				 "0x%llx, '%s', '%s', %d, %d, %d, %d, '%s', '%s'",
+				 get_base_file_id(), get_function(), fn, shard_call_id,
+				 is_static(call->fn), type, param, key, value);
+		goto free;
+	}
+
+	sm_sql_caller_info("insert into caller_info values ("
+			   "0x%llx, '%s', '%s', %%CALL_ID%%, %d, %d, %d, '%s', '%s');",
+			   get_base_file_id(), get_function(), fn, is_static(call->fn),
+			   type, param, key, value);
 
+free:
 	free_string(fn);
 }
 
@@ -450,7 +606,7 @@ void sql_save_constraint(const char *con)
 	if (!option_info)
 		return;
 
-        sm_msg("SQL: insert or ignore into constraints (str) values('%s');", escape_newlines(con));
+        sm_sql("insert or ignore into constraints (str) values('%s');", escape_newlines(con));
 }
 
 void sql_save_constraint_required(const char *data, int op, const char *limit)
@@ -463,7 +619,7 @@ void sql_copy_constraint_required(const char *new_limit, const char *old_limit)
 	if (!option_info)
 		return;
 
-	sm_msg("SQL_late: insert or ignore into constraints_required (data, op, bound) "
+	sm_sql_late("insert or ignore into constraints_required (data, op, bound) "
 		"select constraints_required.data, constraints_required.op, '%s' from "
 		"constraints_required where bound = '%s';", new_limit, old_limit);
 }
@@ -550,6 +706,187 @@ int mtag_map_select_tag(mtag_t container, int offset, mtag_t *tag)
 	return 1;
 }
 
+/*
+ * build_function_filters.pl saves a Bloom filter for each of these tables
+ * with the functions that have rows.  If the function isn't in the filter
+ * then the query is guaranteed to come back empty and we can skip it.
+ */
+struct function_filter {
+	const char *table;
+	unsigned int bits;
+	int hashes;
+	unsigned char *data;
+};
+
+static struct function_filter function_filters[] = {
+	{ "return_states" },
+	{ "call_implies" },
+	{ "return_implies" },
+};
+
+static unsigned long long db_queries_skipped, db_queries_run;
+static unsigned long long prefetch_queue_count, prefetch_hits, prefetch_waits, prefetch_misses;
+static unsigned long long prefetch_saved_ns, prefetch_wait_ns;
+
+static unsigned int fnv1a_hash(const char *str)
+{
+	unsigned int hash = 2166136261U;
+
+	while (*str) {
+		hash ^= (unsigned char)*str++;
+		hash *= 16777619U;
+	}
+	return hash;
+}
+
+static unsigned int djb2_hash32(const char *str)
+{
+	unsigned int hash = 5381;
+
+	while (*str)
+		hash = (hash << 5) + hash + (unsigned char)*str++;
+	return hash;
+}
+
+static void load_function_filters(void)
+{
+	struct function_filter *filter;
+	struct sqlite3_stmt *stmt;
+	const char *table;
+	const void *blob;
+	unsigned int bits;
+	int i;
+
+	if (sqlite3_prepare_v2(smatch_db,
+			       "select tbl, bits, hashes, filter from function_filter;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return;  /* the DB predates the filters */
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		table = (const char *)sqlite3_column_text(stmt, 0);
+		bits = sqlite3_column_int(stmt, 1);
+		blob = sqlite3_column_blob(stmt, 3);
+		if (!table || !bits || (bits & 7) || !blob ||
+		    sqlite3_column_bytes(stmt, 3) != bits / 8)
+			continue;
+
+		for (i = 0; i < ARRAY_SIZE(function_filters); i++) {
+			filter = &function_filters[i];
+			if (strcmp(filter->table, table) != 0)
+				continue;
+			free(filter->data);
+			filter->data = malloc(bits / 8);
+			if (!filter->data)
+				break;
+			memcpy(filter->data, blob, bits / 8);
+			filter->bits = bits;
+			filter->hashes = sqlite3_column_int(stmt, 2);
+		}
+	}
+	sqlite3_finalize(stmt);
+}
+
+static bool function_filter_match(const char *table, struct symbol *sym)
+{
+	struct function_filter *filter = NULL;
+	unsigned int h1, h2, bit;
+	char buf[256];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(function_filters); i++) {
+		if (strcmp(function_filters[i].table, table) == 0) {
+			filter = &function_filters[i];
+			break;
+		}
+	}
+	if (!filter || !filter->data || !sym || !sym->ident)
+		return true;
+
+	if (is_local(sym))
+		snprintf(buf, sizeof(buf), "%lld %s",
+			 (long long)get_base_file_id(), sym->ident->name);
+	else
+		snprintf(buf, sizeof(buf), "%s", sym->ident->name);
+
+	h1 = fnv1a_hash(buf);
+	h2 = djb2_hash32(buf);
+	for (i = 0; i < filter->hashes; i++) {
+		bit = ((unsigned long long)h1 + (unsigned long long)i * h2) % filter->bits;
+		if (!(filter->data[bit / 8] & (1 << (bit % 8))))
+			return false;
+	}
+	return true;
+}
+
+static bool db_function_has_rows(const char *table, struct symbol *sym)
+{
+	char sql[1024];
+
+	if (!function_filter_match(table, sym)) {
+		db_queries_skipped++;
+		if (fn_cache_recording(smatch_db)) {
+			snprintf(sql, sizeof(sql), "select count(*) from %s where %s;",
+				 table, get_static_filter(sym));
+			fn_cache_add_dep(smatch_db, sql);
+		}
+		return false;
+	}
+	db_queries_run++;
+	return true;
+}
+
+void print_db_query_stats(void)
+{
+	if (option_no_db)
+		return;
+	sm_msg("db queries: %llu run %llu skipped", db_queries_run, db_queries_skipped);
+	if (!prefetch_queue_count)
+		return;
+	sm_msg("db prefetch: %llu queued %llu ready %llu waited %llu too late.  %llu.%03llu secs saved %llu.%03llu secs waiting",
+	       prefetch_queue_count, prefetch_hits, prefetch_waits, prefetch_misses,
+	       prefetch_saved_ns / 1000000000, prefetch_saved_ns / 1000000 % 1000,
+	       prefetch_wait_ns / 1000000000, prefetch_wait_ns / 1000000 % 1000);
+}
+
+/*
+ * add_function_ids.sh adds an integer function_id column to the tables we
+ * look up by function name.  It's the same hash as str_to_llu_hash() so
+ * we can search for that instead of comparing strings.
+ */
+static bool have_function_ids;
+
+static void check_for_function_ids(void)
+{
+	static const char *tables[] = {
+		"return_states", "return_summary", "caller_info",
+		"common_caller_info", "call_implies", "return_implies",
+	};
+	struct sqlite3_stmt *stmt;
+	char sql[128];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(tables); i++) {
+		snprintf(sql, sizeof(sql), "select function_id from %s limit 1;",
+			 tables[i]);
+		if (sqlite3_prepare_v2(smatch_db, sql, -1, &stmt, NULL) != SQLITE_OK)
+			return;
+		sqlite3_finalize(stmt);
+	}
+	have_function_ids = true;
+}
+
+static const char *get_function_key(const char *name)
+{
+	static char buf[512];
+
+	if (have_function_ids)
+		snprintf(buf, sizeof(buf), "function_id = 0x%llx",
+			 str_to_llu_hash_helper(name));
+	else
+		snprintf(buf, sizeof(buf), "function = '%s'", name);
+	return buf;
+}
+
 char *get_static_filter(struct symbol *sym)
 {
 	static char sql_filter[1024];
@@ -560,13 +897,17 @@ char *get_static_filter(struct symbol *sym)
 		return sql_filter;
 	}
 
+	/*
+	 * See build_early_index.sh and add_function_ids.sh.  The *_fn_idx and
+	 * *_fid_idx indexes match these.
+	 */
 	if (is_local(sym)) {
 		snprintf(sql_filter, sizeof(sql_filter),
-			 "file = 0x%llx and function = '%s' and static = '1'",
-			 get_base_file_id(), sym->ident->name);
+			 "%s and static = 1 and file = 0x%llx",
+			 get_function_key(sym->ident->name), get_base_file_id());
 	} else {
 		snprintf(sql_filter, sizeof(sql_filter),
-			 "function = '%s' and static = '0'", sym->ident->name);
+			 "%s and static = 0", get_function_key(sym->ident->name));
 	}
 
 	return sql_filter;
@@ -648,9 +989,433 @@ bool is_fn_ptr(struct expression *fn)
 	return false;
 }
 
+/*
+ * build_return_summaries.pl packs all the return_states rows for a function
+ * into a single blob so we can load them with one read instead of a count
+ * and a select per call.  The summaries are cached for the rest of the file
+ * because the same functions get called over and over.
+ *
+ * With --db-prefetch the summaries for every function called from the
+ * current function are queued when we see the definition and a separate
+ * thread loads them using its own connection.  The hash table and the queue
+ * are only changed by the main thread while holding prefetch_lock.  The
+ * prefetch thread only touches the summary it popped off the queue and it
+ * sets ->state to SUMMARY_DONE after it has filled in the data.
+ */
+#define RETURN_STATES_COLS "return_id, return, type, parameter, key, value"
+#define RETURN_SUMMARY_HASH_SIZE 1024
+
+enum summary_state {
+	SUMMARY_DONE,
+	SUMMARY_QUEUED,
+	SUMMARY_LOADING,
+};
+
+struct return_summary {
+	char *filter;
+	int rows;
+	int size;
+	char *data;
+	enum summary_state state;
+	bool prefetched;
+	unsigned long long load_ns;
+	struct return_summary *next;
+	struct return_summary *queue_next;
+};
+static struct return_summary *return_summaries[RETURN_SUMMARY_HASH_SIZE];
+static bool have_return_summaries;
+
+static char *smatch_db_file;
+static struct sqlite3 *prefetch_db;
+static bool prefetch_started;
+static bool prefetch_stop;
+static pthread_t prefetch_thread;
+static pthread_mutex_t prefetch_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t prefetch_queued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t prefetch_done = PTHREAD_COND_INITIALIZER;
+static struct return_summary *prefetch_head, *prefetch_tail;
+static struct return_summary *prefetch_busy;
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void check_for_return_summaries(void)
+{
+	struct sqlite3_stmt *stmt;
+
+	if (sqlite3_prepare_v2(smatch_db, "select rows, summary from return_summary limit 1;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return;
+	sqlite3_finalize(stmt);
+	have_return_summaries = true;
+}
+
+static void load_return_summary(struct sqlite3 *db, struct return_summary *summary)
+{
+	struct sqlite3_stmt *stmt;
+	const void *blob;
+	char *sql;
+	int size;
+
+	sql = sqlite3_mprintf("select rows, summary from return_summary where %s order by file;",
+			      summary->filter);
+	if (db == smatch_db)
+		db_debug("debug: %s\n", sql);
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		sqlite3_free(sql);
+		return;
+	}
+	sqlite3_free(sql);
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		blob = sqlite3_column_blob(stmt, 1);
+		size = sqlite3_column_bytes(stmt, 1);
+		if (!blob || !size)
+			continue;
+		summary->data = realloc(summary->data, summary->size + size);
+		if (!summary->data)
+			sm_fatal("out of memory loading return summaries");
+		memcpy(summary->data + summary->size, blob, size);
+		summary->size += size;
+		summary->rows += sqlite3_column_int(stmt, 0);
+	}
+	sqlite3_finalize(stmt);
+}
+
+/*
+ * Without the summary table the best we can do is read the rows once so
+ * the pages are in the OS cache when the main thread asks for them.
+ */
+static void warm_return_states(struct sqlite3 *db, struct return_summary *summary)
+{
+	struct sqlite3_stmt *stmt;
+	char *sql;
+
+	sql = sqlite3_mprintf("select %s from return_states where %s order by file, return_id, type;",
+			      RETURN_STATES_COLS, summary->filter);
+	if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+		sqlite3_free(sql);
+		return;
+	}
+	sqlite3_free(sql);
+
+	while (sqlite3_step(stmt) == SQLITE_ROW)
+		;
+	sqlite3_finalize(stmt);
+}
+
+static void *prefetch_main(void *unused)
+{
+	struct return_summary *summary;
+	unsigned long long start;
+
+	pthread_mutex_lock(&prefetch_lock);
+	while (1) {
+		while (!prefetch_head && !prefetch_stop)
+			pthread_cond_wait(&prefetch_queued, &prefetch_lock);
+		if (prefetch_stop)
+			break;
+		summary = prefetch_head;
+		prefetch_head = summary->queue_next;
+		if (!prefetch_head)
+			prefetch_tail = NULL;
+		summary->queue_next = NULL;
+		if (summary->state != SUMMARY_QUEUED)
+			continue;
+		summary->state = SUMMARY_LOADING;
+		prefetch_busy = summary;
+		pthread_mutex_unlock(&prefetch_lock);
+
+		start = now_ns();
+		if (have_return_summaries)
+			load_return_summary(prefetch_db, summary);
+		else
+			warm_return_states(prefetch_db, summary);
+
+		pthread_mutex_lock(&prefetch_lock);
+		summary->load_ns = now_ns() - start;
+		summary->state = SUMMARY_DONE;
+		prefetch_busy = NULL;
+		pthread_cond_broadcast(&prefetch_done);
+	}
+	pthread_mutex_unlock(&prefetch_lock);
+	return NULL;
+}
+
+static bool start_prefetch_thread(void)
+{
+	char buf[64];
+
+	if (prefetch_started)
+		return true;
+	if (!smatch_db_file)
+		return false;
+
+	if (sqlite3_open_v2(smatch_db_file, &prefetch_db,
+			    SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX, NULL) != SQLITE_OK)
+		goto fail;
+	snprintf(buf, sizeof(buf), "PRAGMA cache_size = %d;", SQLITE_CACHE_PAGES);
+	sqlite3_exec(prefetch_db, buf, NULL, NULL, NULL);
+	if (pthread_create(&prefetch_thread, NULL, prefetch_main, NULL) != 0)
+		goto fail;
+
+	prefetch_started = true;
+	return true;
+fail:
+	sqlite3_close(prefetch_db);
+	prefetch_db = NULL;
+	option_db_prefetch = 0;
+	return false;
+}
+
+void stop_db_prefetch(void)
+{
+	if (!prefetch_started)
+		return;
+
+	/* the thread finishes the summary it's loading and exits */
+	pthread_mutex_lock(&prefetch_lock);
+	prefetch_head = prefetch_tail = NULL;
+	prefetch_stop = true;
+	pthread_cond_signal(&prefetch_queued);
+	pthread_mutex_unlock(&prefetch_lock);
+
+	pthread_join(prefetch_thread, NULL);
+	sqlite3_close(prefetch_db);
+	prefetch_db = NULL;
+	prefetch_started = false;
+}
+
+static unsigned long hash_filter(const char *filter)
+{
+	unsigned long hash = 5381;
+	const char *p;
+
+	for (p = filter; *p; p++)
+		hash = ((hash << 5) + hash) + *p;
+	return hash % RETURN_SUMMARY_HASH_SIZE;
+}
+
+static struct return_summary *find_return_summary(const char *filter, unsigned long hash)
+{
+	struct return_summary *summary;
+
+	for (summary = return_summaries[hash]; summary; summary = summary->next) {
+		if (strcmp(summary->filter, filter) == 0)
+			return summary;
+	}
+	return NULL;
+}
+
+static struct return_summary *new_return_summary(const char *filter, unsigned long hash)
+{
+	struct return_summary *summary;
+
+	summary = calloc(1, sizeof(*summary));
+	if (!summary)
+		sm_fatal("out of memory loading return summaries");
+	summary->filter = strdup(filter);
+
+	pthread_mutex_lock(&prefetch_lock);
+	summary->next = return_summaries[hash];
+	return_summaries[hash] = summary;
+	pthread_mutex_unlock(&prefetch_lock);
+
+	return summary;
+}
+
+static void wait_for_prefetch(struct return_summary *summary)
+{
+	unsigned long long start;
+	bool load = false;
+
+	if (!summary->prefetched)
+		return;
+
+	pthread_mutex_lock(&prefetch_lock);
+	switch (summary->state) {
+	case SUMMARY_QUEUED:
+		/* we got here first, the thread will skip it */
+		summary->state = SUMMARY_LOADING;
+		prefetch_misses++;
+		load = true;
+		break;
+	case SUMMARY_LOADING:
+		start = now_ns();
+		while (summary->state != SUMMARY_DONE)
+			pthread_cond_wait(&prefetch_done, &prefetch_lock);
+		prefetch_wait_ns += now_ns() - start;
+		prefetch_waits++;
+		break;
+	case SUMMARY_DONE:
+		prefetch_saved_ns += summary->load_ns;
+		prefetch_hits++;
+		break;
+	}
+	summary->prefetched = false;
+	pthread_mutex_unlock(&prefetch_lock);
+
+	if (!load)
+		return;
+	if (have_return_summaries)
+		load_return_summary(smatch_db, summary);
+	pthread_mutex_lock(&prefetch_lock);
+	summary->state = SUMMARY_DONE;
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+/*
+ * When there is no summary table the prefetch thread only warms the pages.
+ * Still wait for it so the two connections aren't reading the same rows.
+ */
+static void wait_for_warm_pages(struct symbol *sym)
+{
+	struct return_summary *summary;
+	const char *filter;
+
+	if (!prefetch_started)
+		return;
+
+	filter = get_static_filter(sym);
+	summary = find_return_summary(filter, hash_filter(filter));
+	if (summary)
+		wait_for_prefetch(summary);
+}
+
+static struct return_summary *get_return_summary(struct symbol *sym)
+{
+	struct return_summary *summary;
+	const char *filter;
+	unsigned long hash;
+	char *sql;
+
+	filter = get_static_filter(sym);
+	hash = hash_filter(filter);
+
+	if (fn_cache_recording(smatch_db)) {
+		/* the blobs have NULs in them */
+		sql = sqlite3_mprintf("select rows, hex(summary) from return_summary where %s order by file;",
+				      filter);
+		fn_cache_add_dep(smatch_db, sql);
+		sqlite3_free(sql);
+	}
+
+	summary = find_return_summary(filter, hash);
+	if (summary) {
+		wait_for_prefetch(summary);
+		return summary;
+	}
+
+	summary = new_return_summary(filter, hash);
+	if (db_function_has_rows("return_states", sym))
+		load_return_summary(smatch_db, summary);
+
+	return summary;
+}
+
+void prefetch_return_states(struct expression *call)
+{
+	struct return_summary *summary;
+	struct expression *fn;
+	const char *filter;
+	unsigned long hash;
+
+	if (!option_db_prefetch || option_no_db)
+		return;
+	if (!call || call->type != EXPR_CALL || is_fake_call(call))
+		return;
+
+	fn = strip_expr(call->fn);
+	if (!fn || fn->type != EXPR_SYMBOL || !fn->symbol || !fn->symbol->ident)
+		return;
+	if (is_fn_ptr(fn) || inlinable(fn))
+		return;
+	if (!function_filter_match("return_states", fn->symbol))
+		return;
+
+	filter = get_static_filter(fn->symbol);
+	hash = hash_filter(filter);
+	if (find_return_summary(filter, hash))
+		return;
+	if (!start_prefetch_thread())
+		return;
+
+	summary = new_return_summary(filter, hash);
+	summary->prefetched = true;
+
+	pthread_mutex_lock(&prefetch_lock);
+	summary->state = SUMMARY_QUEUED;
+	if (prefetch_tail)
+		prefetch_tail->queue_next = summary;
+	else
+		prefetch_head = summary;
+	prefetch_tail = summary;
+	prefetch_queue_count++;
+	pthread_cond_signal(&prefetch_queued);
+	pthread_mutex_unlock(&prefetch_lock);
+}
+
+static void replay_return_summary(struct return_summary *summary,
+	int (*callback)(void*, int, char**, char**), void *info)
+{
+	char *argv[6];
+	char *data, *p, *end;
+	int row, i;
+
+	/* the callbacks get their own copy like they do from sqlite */
+	data = malloc(summary->size);
+	if (!data)
+		return;
+	memcpy(data, summary->data, summary->size);
+
+	p = data;
+	end = data + summary->size;
+	for (row = 0; row < summary->rows; row++) {
+		for (i = 0; i < ARRAY_SIZE(argv); i++) {
+			if (p >= end)
+				goto free;
+			argv[i] = p;
+			p += strnlen(p, end - p) + 1;
+		}
+		if (callback(info, ARRAY_SIZE(argv), argv, NULL))
+			break;
+	}
+free:
+	free(data);
+}
+
+static void clear_return_summaries(struct symbol_list *sym_list)
+{
+	struct return_summary *summary, *next;
+	int i;
+
+	/* drop whatever is still queued and let the thread finish */
+	pthread_mutex_lock(&prefetch_lock);
+	prefetch_head = prefetch_tail = NULL;
+	while (prefetch_busy)
+		pthread_cond_wait(&prefetch_done, &prefetch_lock);
+	pthread_mutex_unlock(&prefetch_lock);
+
+	for (i = 0; i < RETURN_SUMMARY_HASH_SIZE; i++) {
+		for (summary = return_summaries[i]; summary; summary = next) {
+			next = summary->next;
+			free(summary->filter);
+			free(summary->data);
+			free(summary);
+		}
+		return_summaries[i] = NULL;
+	}
+}
+
 void sql_select_return_states(const char *cols, struct expression *call,
 	int (*callback)(void*, int, char**, char**), void *info)
 {
+	struct return_summary *summary = NULL;
 	struct expression *fn;
 	int row_count = 0;
 
@@ -670,8 +1435,16 @@ void sql_select_return_states(const char *cols, struct expression *call,
 		return;
 	}
 
-	run_sql(get_row_count, &row_count, "select count(*) from return_states where %s;",
-		get_static_filter(fn->symbol));
+	if (have_return_summaries && !option_no_db &&
+	    strcmp(cols, RETURN_STATES_COLS) == 0) {
+		summary = get_return_summary(fn->symbol);
+		row_count = summary->rows;
+	} else {
+		wait_for_warm_pages(fn->symbol);
+		if (db_function_has_rows("return_states", fn->symbol))
+			run_sql(get_row_count, &row_count, "select count(*) from return_states where %s;",
+				get_static_filter(fn->symbol));
+	}
 	if (row_count == 0 && fn->symbol && fn->symbol->definition)
 		set_state(my_id, "db_incomplete", NULL, &incomplete);
 	if (row_count == 0 || row_count > 3000) {
@@ -679,6 +1452,11 @@ void sql_select_return_states(const char *cols, struct expression *call,
 		return;
 	}
 
+	if (summary) {
+		replay_return_summary(summary, callback, info);
+		return;
+	}
+
 	run_sql(callback, info, "select %s from return_states where %s order by file, return_id, type;",
 		cols, get_static_filter(fn->symbol));
 }
@@ -708,6 +1486,10 @@ void sql_select_implies(const char *cols, struct implies_info *info,
 		return;
 	}
 
+	if (!db_function_has_rows(info->type == CALL_IMPLIES ?
+				  "call_implies" : "return_implies", info->sym))
+		return;
+
 	run_sql(callback, info, "select %s from %s_implies where %s;",
 		cols,
 		info->type == CALL_IMPLIES ? "call" : "return",
@@ -724,6 +1506,46 @@ struct select_caller_info_data {
 
 static int caller_info_callback(void *_data, int argc, char **argv, char **azColName);
 
+/*
+ * compress_caller_info.pl moves caller_info into caller_info_call and
+ * caller_info_rows, where call sites which pass exactly the same information
+ * share their rows.  Merging the same rows twice doesn't tell us anything
+ * new, so select each set of rows once and use its id as the call_id.
+ */
+#define CALLER_INFO_COLS "call_id, type, parameter, key, value"
+static bool have_caller_info_rows;
+
+static void check_for_caller_info_rows(void)
+{
+	struct sqlite3_stmt *stmt;
+
+	if (sqlite3_prepare_v2(smatch_db, "select rows from caller_info_call limit 1;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return;
+	sqlite3_finalize(stmt);
+	have_caller_info_rows = true;
+}
+
+static void select_caller_info_rows(struct select_caller_info_data *data,
+	const char *cols, const char *table, const char *filter)
+{
+	if (have_caller_info_rows && strcmp(table, "caller_info") == 0 &&
+	    strcmp(cols, CALLER_INFO_COLS) == 0) {
+		run_sql(caller_info_callback, data,
+			"select r.rows, r.type, r.parameter, k.str, v.str from caller_info_rows r"
+			" left join caller_info_string k on k.id = r.key"
+			" left join caller_info_string v on v.id = r.value"
+			" where r.rows in (select rows from caller_info_call where %s)"
+			" order by r.rows, r.idx;",
+			filter);
+		return;
+	}
+
+	run_sql(caller_info_callback, data,
+		"select %s from %s where %s order by call_id;",
+		cols, table, filter);
+}
+
 static void sql_select_caller_info(struct select_caller_info_data *data,
 	const char *cols, struct symbol *sym)
 {
@@ -736,15 +1558,11 @@ static void sql_select_caller_info(struct select_caller_info_data *data,
 
 	if (is_common_function(sym->ident->name))
 		return;
-	run_sql(caller_info_callback, data,
-		"select %s from common_caller_info where %s order by call_id;",
-		cols, get_static_filter(sym));
+	select_caller_info_rows(data, cols, "common_caller_info", get_static_filter(sym));
 	if (data->results)
 		return;
 
-	run_sql(caller_info_callback, data,
-		"select %s from caller_info where %s order by call_id;",
-		cols, get_static_filter(sym));
+	select_caller_info_rows(data, cols, "caller_info", get_static_filter(sym));
 }
 
 void select_caller_info_hook(void (*callback)(const char *name, struct symbol *sym, char *key, char *value), int type)
@@ -939,8 +1757,8 @@ struct range_list *db_return_vals_from_str(const char *fn_name)
 	ret_info.return_range_list = NULL;
 
 	run_sql(db_return_callback, &ret_info,
-		"select distinct return from return_states where function = '%s';",
-		fn_name);
+		"select distinct return from return_states where %s;",
+		get_function_key(fn_name));
 	cached_str_rl = clone_rl(ret_info.return_range_list);
 	return ret_info.return_range_list;
 }
@@ -1407,6 +2225,7 @@ static void match_data_from_db(struct symbol *sym)
 	__unnullify_path();
 
 	if (!__inline_fn) {
+		char filter[512];
 		char *ptr;
 
 		if (sym->ctype.modifiers & MOD_STATIC)
@@ -1421,9 +2240,7 @@ static void match_data_from_db(struct symbol *sym)
 			return;
 		}
 
-		sql_select_caller_info(&data,
-				       "call_id, type, parameter, key, value",
-				       sym);
+		sql_select_caller_info(&data, CALLER_INFO_COLS, sym);
 
 
 		stree = __pop_fake_cur_stree();
@@ -1437,10 +2254,8 @@ static void match_data_from_db(struct symbol *sym)
 		data.results = 0;
 
 		FOR_EACH_PTR(ptr_names, ptr) {
-			run_sql(caller_info_callback, &data,
-				"select call_id, type, parameter, key, value"
-				" from common_caller_info where function = '%s' order by call_id",
-				ptr);
+			snprintf(filter, sizeof(filter), "%s", get_function_key(ptr));
+			select_caller_info_rows(&data, CALLER_INFO_COLS, "common_caller_info", filter);
 		} END_FOR_EACH_PTR(ptr);
 
 		if (data.results) {
@@ -1451,10 +2266,8 @@ static void match_data_from_db(struct symbol *sym)
 		}
 
 		FOR_EACH_PTR(ptr_names, ptr) {
-			run_sql(caller_info_callback, &data,
-				"select call_id, type, parameter, key, value"
-				" from caller_info where function = '%s' order by call_id",
-				ptr);
+			snprintf(filter, sizeof(filter), "%s", get_function_key(ptr));
+			select_caller_info_rows(&data, CALLER_INFO_COLS, "caller_info", filter);
 			free_string(ptr);
 		} END_FOR_EACH_PTR(ptr);
 
@@ -1462,9 +2275,7 @@ free_ptr_names:
 		__free_ptr_list((struct ptr_list **)&ptr_names);
 		__free_ptr_list((struct ptr_list **)&ptr_names_done);
 	} else {
-		sql_select_caller_info(&data,
-				       "call_id, type, parameter, key, value",
-				       sym);
+		sql_select_caller_info(&data, CALLER_INFO_COLS, sym);
 	}
 
 	stree = __pop_fake_cur_stree();
@@ -2713,10 +3524,41 @@ static void match_after_func(struct symbol *sym)
 		reset_memdb(sym);
 }
 
-static void init_memdb(void)
+static void create_tables(struct sqlite3 *db, const char **schema_files, int nr)
 {
+	static char buf[4096];
 	char *err = NULL;
+	int fd;
+	int ret;
 	int rc;
+	int i;
+
+	for (i = 0; i < nr; i++) {
+		fd = open_schema_file(schema_files[i]);
+		if (fd < 0)
+			continue;
+		ret = read(fd, buf, sizeof(buf));
+		if (ret < 0) {
+			sm_ierror("failed to read: %s", schema_files[i]);
+			continue;
+		}
+		close(fd);
+		if (ret == sizeof(buf)) {
+			sm_ierror("Schema file too large:  %s (limit %zd bytes)",
+			       schema_files[i], sizeof(buf));
+			continue;
+		}
+		buf[ret] = '\0';
+		rc = sqlite3_exec(db, buf, NULL, NULL, &err);
+		if (rc != SQLITE_OK) {
+			sm_ierror("SQL error #2: %s", err);
+			sm_ierror("%s", buf);
+		}
+	}
+}
+
+static void init_memdb(void)
+{
 	const char *schema_files[] = {
 		"db/db.schema",
 		"db/caller_info.schema",
@@ -2745,10 +3587,7 @@ static void init_memdb(void)
 		"db/mtag_data.schema",
 		"db/mtag_alias.schema",
 	};
-	static char buf[4096];
-	int fd;
-	int ret;
-	int i;
+	int rc;
 
 	rc = sqlite3_open(":memory:", &mem_db);
 	if (rc != SQLITE_OK) {
@@ -2756,34 +3595,11 @@ static void init_memdb(void)
 		return;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(schema_files); i++) {
-		fd = open_schema_file(schema_files[i]);
-		if (fd < 0)
-			continue;
-		ret = read(fd, buf, sizeof(buf));
-		if (ret < 0) {
-			sm_ierror("failed to read: %s", schema_files[i]);
-			continue;
-		}
-		close(fd);
-		if (ret == sizeof(buf)) {
-			sm_ierror("Schema file too large:  %s (limit %zd bytes)",
-			       schema_files[i], sizeof(buf));
-			continue;
-		}
-		buf[ret] = '\0';
-		rc = sqlite3_exec(mem_db, buf, NULL, NULL, &err);
-		if (rc != SQLITE_OK) {
-			sm_ierror("SQL error #2: %s", err);
-			sm_ierror("%s", buf);
-		}
-	}
+	create_tables(mem_db, schema_files, ARRAY_SIZE(schema_files));
 }
 
 static void init_cachedb(void)
 {
-	char *err = NULL;
-	int rc;
 	const char *schema_files[] = {
 		"db/call_implies.schema",
 		"db/return_implies.schema",
@@ -2794,10 +3610,7 @@ static void init_cachedb(void)
 		"db/sink_info.schema",
 		"db/hash_string.schema",
 	};
-	static char buf[4096];
-	int fd;
-	int ret;
-	int i;
+	int rc;
 
 	rc = sqlite3_open(":memory:", &cache_db);
 	if (rc != SQLITE_OK) {
@@ -2805,28 +3618,59 @@ static void init_cachedb(void)
 		return;
 	}
 
-	for (i = 0; i < ARRAY_SIZE(schema_files); i++) {
-		fd = open_schema_file(schema_files[i]);
-		if (fd < 0)
-			continue;
-		ret = read(fd, buf, sizeof(buf));
-		if (ret < 0) {
-			sm_ierror("failed to read: %s", schema_files[i]);
-			continue;
-		}
-		close(fd);
-		if (ret == sizeof(buf)) {
-			sm_ierror("Schema file too large:  %s (limit %zd bytes)",
-			       schema_files[i], sizeof(buf));
-			continue;
-		}
-		buf[ret] = '\0';
-		rc = sqlite3_exec(cache_db, buf, NULL, NULL, &err);
-		if (rc != SQLITE_OK) {
-			sm_ierror("SQL error #2: %s", err);
-			sm_ierror("%s", buf);
-		}
-	}
+	create_tables(cache_db, schema_files, ARRAY_SIZE(schema_files));
+}
+
+/*
+ * With --db-shard the rows which would have gone to the .smatch.sql and
+ * .smatch.caller_info files are saved in a small database next to the .c
+ * file instead.  merge_db_shards.sh combines them into smatch_db.sqlite.
+ * The call_ids only have to be unique within the shard, the merge makes
+ * them unique across the whole DB.
+ */
+void open_db_shard(const char *base_file)
+{
+	const char *schema_files[] = {
+		"db/caller_info.schema",
+		"db/return_states.schema",
+		"db/call_implies.schema",
+		"db/return_implies.schema",
+		"db/constraints_required.schema",
+		"db/data_info.schema",
+		"db/fn_data_link.schema",
+		"db/fn_ptr_data_link.schema",
+		"db/function_ptr.schema",
+		"db/function_type.schema",
+		"db/function_type_info.schema",
+		"db/function_type_size.schema",
+		"db/function_type_value.schema",
+		"db/local_values.schema",
+		"db/mtag_alias.schema",
+		"db/mtag_map.schema",
+		"db/parameter_name.schema",
+	};
+	char buf[256];
+
+	close_db_shard();
+
+	snprintf(buf, sizeof(buf), "%s.smatch.db", base_file);
+	unlink(buf);
+	if (sqlite3_open(buf, &shard_db) != SQLITE_OK)
+		sm_fatal("Error:  Cannot open %s", buf);
+	sqlite3_exec(shard_db, "PRAGMA synchronous = OFF; PRAGMA journal_mode = OFF;",
+		     NULL, NULL, NULL);
+	create_tables(shard_db, schema_files, ARRAY_SIZE(schema_files));
+	shard_call_id = 0;
+}
+
+void close_db_shard(void)
+{
+	if (!shard_db)
+		return;
+
+	sql_flush_batch(shard_db);
+	sqlite3_close(shard_db);
+	shard_db = NULL;
 }
 
 static int save_cache_data(void *_table, int argc, char **argv, char **azColName)
@@ -2850,7 +3694,7 @@ static int save_cache_data(void *_table, int argc, char **argv, char **azColName
 	if (p - buf > 4096)
 		return 0;
 
-	sm_msg("SQL: %s", buf);
+	sm_sql("%s", buf);
 	return 0;
 }
 
@@ -2890,8 +3734,13 @@ void open_smatch_db(char *db_file)
 		option_no_db = 1;
 		return;
 	}
+	smatch_db_file = strdup(db_file);
 	run_sql(NULL, NULL,
 		"PRAGMA cache_size = %d;", SQLITE_CACHE_PAGES);
+	load_function_filters();
+	check_for_return_summaries();
+	check_for_caller_info_rows();
+	check_for_function_ids();
 	return;
 }
 
@@ -3117,6 +3966,7 @@ void register_definition_db_callbacks(int id)
 	register_forced_return_splits();
 
 	add_hook(&dump_cache, END_FILE_HOOK);
+	add_hook(&clear_return_summaries, END_FILE_HOOK);
 }
 
 void register_definition_db_callbacks_late(int id)
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * With --db-prefetch we look through the function body as soon as we see
+ * the definition and hand every direct call to prefetch_return_states().
+ * The return states are loaded on a separate thread so by the time the
+ * flow walker gets to the call they are usually already in memory.
+ */
+
+#include "smatch.h"
+
+static void prefetch_expr(struct expression *expr, void *unused)
+{
+	if (expr->type == EXPR_CALL)
+		prefetch_return_states(expr);
+}
+
+static const struct ast_walk_ops prefetch_ops = {
+	.expr = prefetch_expr,
+};
+
+static void match_func_def(struct symbol *sym)
+{
+	struct symbol *base;
+
+	if (!option_db_prefetch || option_no_db || __inline_fn)
+		return;
+
+	base = get_base_type(sym);
+	if (!base)
+		return;
+	walk_ast_stmt(base->stmt, &prefetch_ops, NULL);
+	walk_ast_stmt(base->inline_stmt, &prefetch_ops, NULL);
+}
+
+void register_db_prefetch(int id)
+{
+	add_hook(&match_func_def, FUNC_DEF_HOOK);
+}
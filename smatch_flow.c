@@ -61,7 +61,7 @@ struct statement_list *big_statement_stack;
 struct statement *__prev_stmt;
 struct statement *__cur_stmt;
 struct statement *__next_stmt;
-static struct expression_list *parsed_calls;
+static unsigned int parsed_call_gen = 1;
 static int indent_cnt;
 int __in_pre_condition = 0;
 int __bail_on_rest_of_function = 0;
@@ -79,7 +79,6 @@ static void split_declaration(struct symbol_list *sym_list);
 static void split_expr_list(struct expression_list *expr_list, struct expression *parent);
 static void split_args(struct expression *expr);
 static struct expression *fake_a_variable_assign(struct symbol *type, struct expression *call, struct expression *expr, int nr);
-static void add_inline_function(struct symbol *sym);
 static void parse_inline(struct expression *expr);
 
 int option_assume_loops = 0;
@@ -243,7 +242,7 @@ static int get_func_time(struct symbol *sym)
 	unsigned long time = 0;
 
 	run_sql(&save_func_time, &time,
-		"select key from return_implies where %s and type = %d;",
+		"select value from return_implies where %s and type = %d;",
 		get_static_filter(sym), FUNC_TIME);
 
 	return time;
@@ -286,6 +285,7 @@ int inlinable(struct expression *expr)
 	if (last_stmt->pos.line > sym->pos.line + inline_budget)
 		return 0;
 
+	/* if it took two seconds to parse on its own, don't redo it each call */
 	if (get_func_time(expr->symbol) >= 2)
 		return 0;
 
@@ -543,7 +543,7 @@ static void split_call(struct expression *expr)
 	if (!expr_get_parent_expr(expr) && indent_cnt == 1)
 		__discard_fake_states(expr);
 	handle_builtin_overflow_func(expr);
-	__add_ptr_list((struct ptr_list **)&parsed_calls, expr);
+	expr->parsed_gen = parsed_call_gen;
 }
 
 void parse_assignment(struct expression *expr)
@@ -1268,20 +1268,29 @@ static void find_asm_gotos(struct statement *stmt)
 	} END_FOR_EACH_PTR(sym);
 }
 
-static bool already_parsed_call(struct expression *call)
+/*
+ * Calls are marked with the current generation when they are parsed.  Starting
+ * a new generation forgets about all the calls parsed in the old one without
+ * having to walk through them.
+ */
+static unsigned int new_parsed_call_gen(void)
 {
-	struct expression *expr;
+	static unsigned int last_gen = 1;
 
-	FOR_EACH_PTR(parsed_calls, expr) {
-		if (expr == call)
-			return true;
-	} END_FOR_EACH_PTR(expr);
-	return false;
+	last_gen++;
+	if (last_gen >= 1U << 28)
+		last_gen = 2;
+	return last_gen;
+}
+
+static bool already_parsed_call(struct expression *call)
+{
+	return call && call->parsed_gen == parsed_call_gen;
 }
 
 static void free_parsed_call_stuff(bool free_fake_states)
 {
-	free_expression_stack(&parsed_calls);
+	parsed_call_gen = new_parsed_call_gen();
 	if (free_fake_states)
 		__discard_fake_states(NULL);
 }
@@ -1938,12 +1947,14 @@ static void clear_function_data(void)
 
 static void record_func_time(void)
 {
-	struct timeval stop;
 	int func_time;
 	char buf[32];
 
-	gettimeofday(&stop, NULL);
-	func_time = stop.tv_sec - fn_start_time.tv_sec;
+	/*
+	 * Whole seconds so almost everything records 0 and two runs build the
+	 * same DB.  schedule_files.sh keeps its own per file times.
+	 */
+	func_time = time_parsing_function();
 	snprintf(buf, sizeof(buf), "%d", func_time);
 	sql_insert_return_implies(FUNC_TIME, 0, "", buf);
 	if (option_time && func_time > 2) {
@@ -1953,22 +1964,12 @@ static void record_func_time(void)
 	}
 }
 
-static void split_function(struct symbol *sym)
+static void parse_function(struct symbol *sym)
 {
 	struct symbol *base_type = get_base_type(sym);
 
-	if (!base_type->stmt && !base_type->inline_stmt)
-		return;
-
 	gettimeofday(&outer_fn_start_time, NULL);
 	gettimeofday(&fn_start_time, NULL);
-	cur_func_sym = sym;
-	if (sym->ident)
-		cur_func = sym->ident->name;
-	if (option_process_function && cur_func &&
-	    strcmp(option_process_function, cur_func) != 0)
-		return;
-	set_position(sym->pos);
 	clear_function_data();
 	loop_count = 0;
 	last_goto_statement_handled = 0;
@@ -1999,18 +2000,58 @@ static void split_function(struct symbol *sym)
 	if (need_delayed_scope_hooks())
 		__call_scope_hooks();
 	__pass_to_client(sym, AFTER_FUNC_HOOK);
-	sym->parsed = true;
+}
 
+static void free_function_states(void)
+{
 	clear_all_states();
+	free_data_info_allocs();
+	free_expression_stack(&switch_expr_stack);
+	__free_ptr_list((struct ptr_list **)&big_statement_stack);
+	__bail_on_rest_of_function = 0;
+}
+
+static void split_function(struct symbol *sym)
+{
+	struct symbol *base_type = get_base_type(sym);
+	bool full_pass = true;
+
+	if (!base_type->stmt && !base_type->inline_stmt)
+		return;
+
+	cur_func_sym = sym;
+	if (sym->ident)
+		cur_func = sym->ident->name;
+	if (option_process_function && cur_func &&
+	    strcmp(option_process_function, cur_func) != 0)
+		return;
+	if (changed_lines_skip_function(sym))
+		return;
+	set_position(sym->pos);
+	if (load_fn_results(sym)) {
+		sym->parsed = true;
+		cur_func_sym = NULL;
+		cur_func = NULL;
+		return;
+	}
+	if (option_tiered) {
+		tiered_start_cheap_pass();
+		parse_function(sym);
+		free_function_states();
+		full_pass = tiered_end_cheap_pass();
+	}
+	if (full_pass) {
+		parse_function(sym);
+		free_function_states();
+		tiered_end_full_pass();
+	}
+	sym->parsed = true;
+	save_fn_results(sym);
 
 	record_func_time();
 
 	cur_func_sym = NULL;
 	cur_func = NULL;
-	free_data_info_allocs();
-	free_expression_stack(&switch_expr_stack);
-	__free_ptr_list((struct ptr_list **)&big_statement_stack);
-	__bail_on_rest_of_function = 0;
 }
 
 static void save_flow_state(void)
@@ -2028,7 +2069,7 @@ static void save_flow_state(void)
 
 	__add_ptr_list(&backup, cur_func_sym);
 
-	__add_ptr_list(&backup, parsed_calls);
+	__add_ptr_list(&backup, INT_PTR(parsed_call_gen << 2));
 
 	__add_ptr_list(&backup, __prev_stmt);
 	__add_ptr_list(&backup, __cur_stmt);
@@ -2060,7 +2101,7 @@ static void restore_flow_state(void)
 	__cur_stmt = pop_backup();
 	__prev_stmt = pop_backup();
 
-	parsed_calls = pop_backup();
+	parsed_call_gen = PTR_INT(pop_backup()) >> 2;
 
 	cur_func_sym = pop_backup();
 	switch_expr_stack = pop_backup();
@@ -2078,6 +2119,7 @@ void parse_inline(struct expression *call)
 	char *cur_func_bak = cur_func;  /* not aligned correctly for backup */
 	struct timeval time_backup = fn_start_time;
 	struct expression *orig_inline = __inline_fn;
+	unsigned long long orig_fn_mtag = __fn_mtag;
 	int orig_budget;
 
 	if (out_of_memory() || taking_too_long())
@@ -2086,6 +2128,11 @@ void parse_inline(struct expression *call)
 	if (already_parsed_call(call))
 		return;
 
+	if (load_inline_results(call)) {
+		call->fn->symbol->parsed = true;
+		return;
+	}
+
 	save_flow_state();
 
 	__pass_to_client(call, INLINE_FN_START);
@@ -2107,7 +2154,7 @@ void parse_inline(struct expression *call)
 	big_expression_stack = NULL;
 	big_condition_stack = NULL;
 	switch_expr_stack = NULL;
-	parsed_calls = NULL;
+	parsed_call_gen = new_parsed_call_gen();
 
 	sm_debug("inline function:  %s\n", cur_func);
 	__unnullify_path();
@@ -2120,6 +2167,8 @@ void parse_inline(struct expression *call)
 	__pass_to_client(call->fn->symbol, END_FUNC_HOOK);
 	__pass_to_client(call->fn->symbol, AFTER_FUNC_HOOK);
 	call->fn->symbol->parsed = true;
+	sql_flush_batch(mem_db);
+	save_inline_results(call);
 
 	free_expression_stack(&switch_expr_stack);
 	__free_ptr_list((struct ptr_list **)&big_statement_stack);
@@ -2133,23 +2182,21 @@ void parse_inline(struct expression *call)
 	restore_all_states();
 	set_position(call->pos);
 	__inline_fn = orig_inline;
+	/* the inline's FUNC_DEF hooks set this to the inline's mtag */
+	__fn_mtag = orig_fn_mtag;
 	inline_budget = orig_budget;
 	__pass_to_client(call, INLINE_FN_END);
 }
 
 static struct symbol_list *inlines_called;
-static void add_inline_function(struct symbol *sym)
+void add_inline_function(struct symbol *sym)
 {
-	static struct symbol_list *already_added;
-	struct symbol *tmp;
-
-	FOR_EACH_PTR(already_added, tmp) {
-		if (tmp == sym)
-			return;
-	} END_FOR_EACH_PTR(tmp);
+	if (sym->inline_added)
+		return;
 
-	add_ptr_list(&already_added, sym);
+	sym->inline_added = true;
 	add_ptr_list(&inlines_called, sym);
+	fn_cache_add_inline(sym);
 }
 
 static void process_inlines(void)
@@ -2260,10 +2307,14 @@ static void split_c_file_functions(struct symbol_list *sym_list)
 {
 	struct symbol *sym;
 
+	fn_cache_start_file(sym_list);
+	changed_lines_start_file(sym_list);
 	__unnullify_path();
 	FOR_EACH_PTR(sym_list, sym) {
 		set_position(sym->pos);
 		if (sym->type != SYM_NODE || get_base_type(sym)->type != SYM_FN) {
+			if (changed_lines_skip_global(sym))
+				continue;
 			__pass_to_client(sym, BASE_HOOK);
 			fake_global_assign(sym);
 			__pass_to_client(sym, DECLARATION_HOOK_AFTER);
@@ -2313,19 +2364,22 @@ static void open_output_files(char *base_file)
 	sm_outfd = fopen(buf, "w");
 	if (!sm_outfd)
 		sm_fatal("Cannot open %s", buf);
+	info_frames_new_fd(sm_outfd);
 
-	if (!option_info)
+	if (!option_info || option_db_shard)
 		return;
 
 	snprintf(buf, sizeof(buf), "%s.smatch.sql", base_file);
 	sql_outfd = fopen(buf, "w");
 	if (!sql_outfd)
 		sm_fatal("Error:  Cannot open %s", buf);
+	info_frames_new_fd(sql_outfd);
 
 	snprintf(buf, sizeof(buf), "%s.smatch.caller_info", base_file);
 	caller_info_fd = fopen(buf, "w");
 	if (!caller_info_fd)
 		sm_fatal("Error:  Cannot open %s", buf);
+	info_frames_new_fd(caller_info_fd);
 }
 
 void smatch(struct string_list *filelist)
@@ -2349,17 +2403,25 @@ void smatch(struct string_list *filelist)
 		}
 		if (option_file_output)
 			open_output_files(base_file);
+		if (option_info && option_db_shard)
+			open_db_shard(base_file);
 		base_file_stream = input_stream_nr;
 		sym_list = sparse_keep_tokens(base_file);
 		split_c_file_functions(sym_list);
 	} END_FOR_EACH_PTR_NOTAG(base_file);
+	close_db_shard();
+	stop_db_prefetch();
 
 	gettimeofday(&stop, NULL);
 
 	set_position(last_pos);
 	final_pass = 1;
-	if (option_time)
+	if (option_time) {
 		sm_msg("time: %lu", stop.tv_sec - start.tv_sec);
+		print_db_query_stats();
+		print_fn_cache_stats();
+	}
+	print_tiered_stats();
 	if (option_mem)
 		sm_msg("mem: %luKb", get_max_memory());
 }
@@ -0,0 +1,1718 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * With --fn-cache=<file> the warnings for each function are saved along
+ * with every DB query the function did and a hash of what the query
+ * returned.  On the next run, if the function is the same and all the
+ * queries still return the same rows then we print the saved warnings
+ * instead of parsing the function again.
+ *
+ * The key is a hash of the function after preprocessing (including the
+ * line numbers because they are part of the warnings), the bodies of the
+ * functions it calls which might get inlined, the initializers of the
+ * globals it uses, the smatch binary, the smatch_data/ directory and the
+ * command line.
+ *
+ * Later functions in the file can read what was put into cache_db so the
+ * inserts are saved and replayed as well.  The --info output depends on
+ * things which are built up over the whole file, like the global type
+ * values, so the function results are not used with --info.
+ *
+ * The rows from parsing an inline at a call site are saved the same way
+ * but they are shared between files, see load_inline_results().
+ */
+
+#include <ctype.h>
+#include <dirent.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <openssl/evp.h>
+#include "smatch.h"
+#include "smatch_slist.h"
+
+#define FN_HASH_SIZE 20
+#define FN_KEY_LEN (FN_HASH_SIZE * 2 + 1)
+#define FN_DEP_HASH_SIZE 256
+#define BODY_HASH_SIZE 1024
+#define FN_CACHE_VERSION "3"
+
+enum {
+	DEP_SMATCH_DB,
+	DEP_CACHE_DB,
+	DEP_MEM_DB,
+	DEP_MTAG_DATA,
+};
+
+struct fn_dep {
+	int db;
+	char *sql;
+	char hash[FN_KEY_LEN];
+	struct fn_dep *next;
+	struct fn_dep *hash_next;
+};
+
+struct fn_result {
+	char key[FN_KEY_LEN];
+	char *output;
+	size_t output_size;
+	char *sql;
+	char *mtag_data;
+	char *inlines;
+	int checks;
+	int errors;
+	struct fn_dep *deps;
+	struct fn_result *next;
+};
+
+struct inline_result {
+	char key[FN_KEY_LEN];
+	char *mem_sql;
+	char *cache_sql;
+	char *mtag_data;
+	int return_ids;
+	struct fn_dep *deps;
+	struct inline_result *next;
+};
+
+struct body_hash {
+	struct symbol *sym;
+	unsigned char md[FN_HASH_SIZE];
+	struct symbol_list *callees;
+	struct symbol_list *inlines;
+	bool file_local;
+	struct body_hash *next;
+};
+
+struct hash_walk {
+	EVP_MD_CTX *ctx;
+	struct symbol_list *callees;
+	struct symbol_list *inlines;
+	int in_initializer;
+	int stream;
+	bool file_local;
+};
+
+struct dep_list {
+	struct fn_dep *head, **tail;
+	struct fn_dep *hash[FN_DEP_HASH_SIZE];
+};
+
+struct row_hash {
+	EVP_MD_CTX *ctx;
+	int (*callback)(void*, int, char**, char**);
+	void *data;
+};
+
+static struct sqlite3 *fn_cache_db;
+static unsigned char args_md[FN_HASH_SIZE];
+static unsigned char smatch_args_md[FN_HASH_SIZE];
+static unsigned char global_md[FN_HASH_SIZE];
+static unsigned char inline_md[FN_HASH_SIZE];
+static struct body_hash *body_hashes[BODY_HASH_SIZE];
+
+static bool recording;
+static bool uncacheable;
+static char cur_key[FN_KEY_LEN];
+static FILE *real_outfd;
+static char *out_buf;
+static size_t out_size;
+static char *replay_sql, *replay_mtag;
+static size_t replay_len, replay_size;
+static size_t replay_mtag_len, replay_mtag_size;
+static char *inline_names;
+static size_t inline_len, inline_size;
+static struct symbol_list *inline_candidates;
+static int start_checks, start_errors;
+static struct dep_list fn_deps = { .tail = &fn_deps.head };
+static struct fn_result *pending;
+
+static bool inline_recording;
+static bool inline_uncacheable;
+static bool inline_file_local;
+static char inline_key[FN_KEY_LEN];
+static char inline_caller_info[64];
+static int start_return_id;
+static char file_id[32];
+static char file_id_insert[PATH_MAX];
+static char call_id[32];
+static char *inline_mem_sql, *inline_cache_sql, *inline_mtag;
+static size_t inline_mem_len, inline_mem_size;
+static size_t inline_cache_len, inline_cache_size;
+static size_t inline_mtag_len, inline_mtag_size;
+static struct dep_list inline_deps = { .tail = &inline_deps.head };
+static struct inline_result *pending_inlines;
+
+static unsigned long long fn_cache_hits;
+static unsigned long long fn_cache_misses;
+static unsigned long long fn_cache_stale;
+static unsigned long long fn_cache_not_saved;
+static unsigned long long inline_hits;
+static unsigned long long inline_misses;
+static unsigned long long inline_stale;
+static unsigned long long inline_not_saved;
+
+static void md_to_str(const unsigned char *md, char *buf)
+{
+	int i;
+
+	for (i = 0; i < FN_HASH_SIZE; i++)
+		snprintf(buf + i * 2, 3, "%02x", md[i]);
+}
+
+static EVP_MD_CTX *new_hash_ctx(void)
+{
+	EVP_MD_CTX *ctx;
+
+	ctx = EVP_MD_CTX_create();
+	EVP_DigestInit_ex(ctx, EVP_sha1(), NULL);
+	return ctx;
+}
+
+static void finish_hash_ctx(EVP_MD_CTX *ctx, unsigned char *md)
+{
+	EVP_DigestFinal_ex(ctx, md, NULL);
+	EVP_MD_CTX_destroy(ctx);
+}
+
+static void hash_int(struct hash_walk *w, long long val)
+{
+	EVP_DigestUpdate(w->ctx, &val, sizeof(val));
+}
+
+static void hash_str(struct hash_walk *w, const char *str, int len)
+{
+	if (!str) {
+		hash_int(w, -1);
+		return;
+	}
+	hash_int(w, len);
+	EVP_DigestUpdate(w->ctx, str, len);
+}
+
+static void hash_name(struct hash_walk *w, struct ident *ident)
+{
+	if (!ident) {
+		hash_str(w, NULL, 0);
+		return;
+	}
+	hash_str(w, ident->name, ident->len);
+}
+
+/*
+ * The stream numbers depend on the include order so use the names.  They
+ * only get hashed when they change.
+ */
+static void hash_pos(struct hash_walk *w, struct position pos)
+{
+	const char *name;
+
+	if (pos.stream != w->stream) {
+		w->stream = pos.stream;
+		name = stream_name(pos.stream);
+		hash_str(w, name, strlen(name));
+	}
+	hash_int(w, pos.line);
+}
+
+static void hash_type(struct hash_walk *w, struct symbol *type)
+{
+	int depth;
+
+	/* Struct members aren't followed, the sizes are enough. */
+	for (depth = 0; type && depth < 8; depth++) {
+		/* the sizes are filled in lazily */
+		if (type->type == SYM_PTR || type->type == SYM_ARRAY ||
+		    type->type == SYM_STRUCT || type->type == SYM_UNION)
+			examine_symbol_type(type);
+		hash_int(w, type->type);
+		hash_name(w, type->ident);
+		if (type->type == SYM_NODE) {
+			/* the rest gets copied from the base type later */
+			hash_int(w, type->ctype.modifiers & MOD_STORAGE);
+		} else {
+			hash_int(w, type->bit_size);
+			hash_int(w, type->ctype.modifiers);
+		}
+		if (type->type == SYM_STRUCT ||
+		    type->type == SYM_UNION ||
+		    type->type == SYM_ENUM)
+			return;
+		type = type->ctype.base_type;
+	}
+}
+
+static void hash_expr(struct hash_walk *w, struct expression *expr);
+static void hash_stmt(struct hash_walk *w, struct statement *stmt);
+
+static void hash_symbol(struct hash_walk *w, struct symbol *sym)
+{
+	if (!sym) {
+		hash_int(w, 0);
+		return;
+	}
+	hash_name(w, sym->ident);
+	hash_type(w, sym);
+
+	/* the local initializers are hashed with the declarations */
+	if (!(sym->ctype.modifiers & MOD_TOPLEVEL))
+		return;
+	/* every file has its own copy and the mtags are based on the file */
+	if ((sym->ctype.modifiers & MOD_STATIC) &&
+	    get_base_type(sym) && get_base_type(sym)->type != SYM_FN)
+		w->file_local = true;
+	if (w->in_initializer)
+		return;
+	w->in_initializer++;
+	hash_expr(w, sym->initializer);
+	w->in_initializer--;
+}
+
+static void hash_declaration(struct hash_walk *w, struct symbol_list *sym_list)
+{
+	struct symbol *sym;
+
+	FOR_EACH_PTR(sym_list, sym) {
+		hash_name(w, sym->ident);
+		hash_type(w, sym);
+		hash_expr(w, sym->initializer);
+	} END_FOR_EACH_PTR(sym);
+}
+
+static void hash_expr_list(struct hash_walk *w, struct expression_list *list)
+{
+	struct expression *tmp;
+
+	hash_int(w, ptr_list_size((struct ptr_list *)list));
+	FOR_EACH_PTR(list, tmp) {
+		hash_expr(w, tmp);
+	} END_FOR_EACH_PTR(tmp);
+}
+
+static void hash_asm_operands(struct hash_walk *w, struct asm_operand_list *list)
+{
+	struct asm_operand *op;
+
+	hash_int(w, ptr_list_size((struct ptr_list *)list));
+	FOR_EACH_PTR(list, op) {
+		hash_name(w, op->name);
+		hash_expr(w, op->constraint);
+		hash_expr(w, op->expr);
+	} END_FOR_EACH_PTR(op);
+}
+
+static void add_callee(struct hash_walk *w, struct expression *fn)
+{
+	struct symbol *base;
+
+	if (!fn || fn->type != EXPR_SYMBOL || !fn->symbol)
+		return;
+	if (fn->symbol->definition &&
+	    (fn->symbol->definition->ctype.modifiers & MOD_INLINE))
+		add_ptr_list(&w->inlines, fn->symbol->definition);
+	base = get_base_type(fn->symbol);
+	if (!base || (!base->stmt && !base->inline_stmt))
+		return;
+	add_ptr_list(&w->callees, fn->symbol);
+}
+
+static void hash_expr(struct hash_walk *w, struct expression *expr)
+{
+	char buf[64];
+
+	if (!expr) {
+		hash_int(w, 0);
+		return;
+	}
+
+	hash_int(w, expr->type);
+	hash_int(w, expr->op);
+	hash_pos(w, expr->pos);
+
+	switch (expr->type) {
+	case EXPR_VALUE:
+		hash_int(w, expr->value);
+		break;
+	case EXPR_FVALUE:
+		snprintf(buf, sizeof(buf), "%Lg", expr->fvalue);
+		hash_str(w, buf, strlen(buf));
+		break;
+	case EXPR_STRING:
+		hash_int(w, expr->wide);
+		if (expr->string)
+			hash_str(w, expr->string->data, expr->string->length);
+		break;
+	case EXPR_SYMBOL:
+	case EXPR_TYPE:
+		hash_name(w, expr->symbol_name);
+		hash_symbol(w, expr->symbol);
+		break;
+	case EXPR_CALL:
+		add_callee(w, expr->fn);
+		hash_expr(w, expr->fn);
+		hash_expr_list(w, expr->args);
+		break;
+	case EXPR_PREOP:
+	case EXPR_POSTOP:
+		hash_expr(w, expr->unop);
+		break;
+	case EXPR_BINOP:
+	case EXPR_COMMA:
+	case EXPR_COMPARE:
+	case EXPR_LOGICAL:
+	case EXPR_ASSIGNMENT:
+		hash_expr(w, expr->left);
+		hash_expr(w, expr->right);
+		break;
+	case EXPR_DEREF:
+		hash_expr(w, expr->deref);
+		hash_name(w, expr->member);
+		break;
+	case EXPR_SLICE:
+		hash_expr(w, expr->base);
+		hash_int(w, expr->r_bitpos);
+		break;
+	case EXPR_CAST:
+	case EXPR_FORCE_CAST:
+	case EXPR_IMPLIED_CAST:
+	case EXPR_SIZEOF:
+	case EXPR_ALIGNOF:
+	case EXPR_PTRSIZEOF:
+		hash_type(w, expr->cast_type);
+		hash_expr(w, expr->cast_expression);
+		break;
+	case EXPR_CONDITIONAL:
+	case EXPR_SELECT:
+		hash_expr(w, expr->conditional);
+		hash_expr(w, expr->cond_true);
+		hash_expr(w, expr->cond_false);
+		break;
+	case EXPR_STATEMENT:
+		hash_stmt(w, expr->statement);
+		break;
+	case EXPR_LABEL:
+		if (expr->label_symbol)
+			hash_name(w, expr->label_symbol->ident);
+		break;
+	case EXPR_INITIALIZER:
+		hash_expr_list(w, expr->expr_list);
+		break;
+	case EXPR_IDENTIFIER:
+		hash_int(w, expr->offset);
+		hash_name(w, expr->expr_ident);
+		hash_expr(w, expr->ident_expression);
+		break;
+	case EXPR_INDEX:
+		hash_int(w, expr->idx_from);
+		hash_int(w, expr->idx_to);
+		hash_expr(w, expr->idx_expression);
+		break;
+	case EXPR_POS:
+		hash_int(w, expr->init_offset);
+		hash_int(w, expr->init_nr);
+		hash_expr(w, expr->init_expr);
+		break;
+	case EXPR_OFFSETOF:
+		hash_type(w, expr->in);
+		hash_expr(w, expr->down);
+		if (expr->op == '.')
+			hash_name(w, expr->ident);
+		else
+			hash_expr(w, expr->index);
+		break;
+	case EXPR_GENERIC:
+		hash_expr(w, expr->control);
+		hash_expr(w, expr->def);
+		break;
+	}
+}
+
+static void hash_stmt(struct hash_walk *w, struct statement *stmt)
+{
+	struct statement *tmp;
+
+	if (!stmt) {
+		hash_int(w, 0);
+		return;
+	}
+
+	hash_int(w, stmt->type);
+	hash_pos(w, stmt->pos);
+
+	switch (stmt->type) {
+	case STMT_NONE:
+		break;
+	case STMT_DECLARATION:
+		hash_declaration(w, stmt->declaration);
+		break;
+	case STMT_EXPRESSION:
+		hash_expr(w, stmt->expression);
+		break;
+	case STMT_CONTEXT:
+		hash_expr(w, stmt->expression);
+		hash_expr(w, stmt->context);
+		break;
+	case STMT_RETURN:
+		hash_expr(w, stmt->ret_value);
+		break;
+	case STMT_COMPOUND:
+		hash_stmt(w, stmt->args);
+		hash_int(w, ptr_list_size((struct ptr_list *)stmt->stmts));
+		FOR_EACH_PTR(stmt->stmts, tmp) {
+			hash_stmt(w, tmp);
+		} END_FOR_EACH_PTR(tmp);
+		break;
+	case STMT_IF:
+		hash_expr(w, stmt->if_conditional);
+		hash_stmt(w, stmt->if_true);
+		hash_stmt(w, stmt->if_false);
+		break;
+	case STMT_ITERATOR:
+		hash_stmt(w, stmt->iterator_pre_statement);
+		hash_expr(w, stmt->iterator_pre_condition);
+		hash_stmt(w, stmt->iterator_statement);
+		hash_stmt(w, stmt->iterator_post_statement);
+		hash_expr(w, stmt->iterator_post_condition);
+		break;
+	case STMT_SWITCH:
+		hash_expr(w, stmt->switch_expression);
+		hash_stmt(w, stmt->switch_statement);
+		break;
+	case STMT_CASE:
+		hash_expr(w, stmt->case_expression);
+		hash_expr(w, stmt->case_to);
+		hash_stmt(w, stmt->case_statement);
+		break;
+	case STMT_LABEL:
+		if (stmt->label_identifier)
+			hash_name(w, stmt->label_identifier->ident);
+		hash_stmt(w, stmt->label_statement);
+		break;
+	case STMT_GOTO:
+		if (stmt->goto_label)
+			hash_name(w, stmt->goto_label->ident);
+		hash_expr(w, stmt->goto_expression);
+		break;
+	case STMT_ASM:
+		hash_expr(w, stmt->asm_string);
+		hash_asm_operands(w, stmt->asm_outputs);
+		hash_asm_operands(w, stmt->asm_inputs);
+		hash_expr_list(w, stmt->asm_clobbers);
+		break;
+	case STMT_RANGE:
+		hash_expr(w, stmt->range_expression);
+		hash_expr(w, stmt->range_low);
+		hash_expr(w, stmt->range_high);
+		break;
+	}
+}
+
+static void hash_function(struct body_hash *body)
+{
+	struct symbol *sym = body->sym;
+	struct hash_walk w = { .stream = -1 };
+	struct symbol *base, *arg;
+
+	base = get_base_type(sym);
+
+	w.ctx = new_hash_ctx();
+	hash_pos(&w, sym->pos);
+	hash_symbol(&w, sym);
+	FOR_EACH_PTR(base->arguments, arg) {
+		hash_name(&w, arg->ident);
+		hash_type(&w, arg);
+	} END_FOR_EACH_PTR(arg);
+	hash_stmt(&w, base->stmt);
+	hash_stmt(&w, base->inline_stmt);
+	finish_hash_ctx(w.ctx, body->md);
+
+	body->callees = w.callees;
+	body->inlines = w.inlines;
+	body->file_local = w.file_local;
+}
+
+static struct body_hash *get_body_hash(struct symbol *sym)
+{
+	struct body_hash *body;
+	unsigned long hash;
+
+	hash = ((unsigned long)sym >> 4) % BODY_HASH_SIZE;
+	for (body = body_hashes[hash]; body; body = body->next) {
+		if (body->sym == sym)
+			return body;
+	}
+
+	body = calloc(1, sizeof(*body));
+	if (!body)
+		sm_fatal("out of memory in the function cache");
+	body->sym = sym;
+	hash_function(body);
+	body->next = body_hashes[hash];
+	body_hashes[hash] = body;
+	return body;
+}
+
+/*
+ * Parsing a function changes the tree a bit.  Sizes get filled in, parens
+ * get stripped and the compares get turned into unsigned compares.  So hash
+ * everything before we start.
+ */
+void fn_cache_start_file(struct symbol_list *sym_list)
+{
+	struct symbol *sym, *base;
+
+	if (!fn_cache_db)
+		return;
+
+	FOR_EACH_PTR(sym_list, sym) {
+		if (sym->type != SYM_NODE)
+			continue;
+		base = get_base_type(sym);
+		if (!base || base->type != SYM_FN)
+			continue;
+		if (!base->stmt && !base->inline_stmt)
+			continue;
+		get_body_hash(sym);
+	} END_FOR_EACH_PTR(sym);
+}
+
+static void get_fn_key(struct symbol *sym, char *key)
+{
+	unsigned char md[FN_HASH_SIZE];
+	struct body_hash *body, *callee_body;
+	struct symbol *callee;
+	EVP_MD_CTX *ctx;
+
+	/*
+	 * The inline functions which get queued while parsing the function
+	 * are called from the function or from one of the callees which
+	 * might get inlined.
+	 */
+	free_ptr_list(&inline_candidates);
+
+	body = get_body_hash(sym);
+	ctx = new_hash_ctx();
+	EVP_DigestUpdate(ctx, global_md, sizeof(global_md));
+	EVP_DigestUpdate(ctx, body->md, sizeof(body->md));
+	concat_symbol_list(body->inlines, &inline_candidates);
+	FOR_EACH_PTR(body->callees, callee) {
+		callee_body = get_body_hash(callee);
+		EVP_DigestUpdate(ctx, callee_body->md, sizeof(callee_body->md));
+		concat_symbol_list(callee_body->inlines, &inline_candidates);
+	} END_FOR_EACH_PTR(callee);
+	finish_hash_ctx(ctx, md);
+
+	md_to_str(md, key);
+}
+
+static void free_body_hashes(void)
+{
+	struct body_hash *body, *next;
+	int i;
+
+	for (i = 0; i < BODY_HASH_SIZE; i++) {
+		for (body = body_hashes[i]; body; body = next) {
+			next = body->next;
+			free_ptr_list(&body->callees);
+			free_ptr_list(&body->inlines);
+			free(body);
+		}
+		body_hashes[i] = NULL;
+	}
+}
+
+static int hash_row(void *_rh, int argc, char **argv, char **azColName)
+{
+	struct row_hash *rh = _rh;
+	int i;
+
+	EVP_DigestUpdate(rh->ctx, &argc, sizeof(argc));
+	for (i = 0; i < argc; i++) {
+		if (argv[i])
+			EVP_DigestUpdate(rh->ctx, argv[i], strlen(argv[i]) + 1);
+		else
+			EVP_DigestUpdate(rh->ctx, "\1", 1);
+	}
+	if (rh->callback)
+		return rh->callback(rh->data, argc, argv, azColName);
+	return 0;
+}
+
+static int hash_query(struct sqlite3 *db, const char *sql,
+		      int (*callback)(void*, int, char**, char**), void *data,
+		      char **err, char *hash)
+{
+	unsigned char md[FN_HASH_SIZE];
+	struct row_hash rh = {
+		.callback = callback,
+		.data = data,
+	};
+	int rc;
+
+	rh.ctx = new_hash_ctx();
+	rc = sqlite3_exec(db, sql, hash_row, &rh, err);
+	finish_hash_ctx(rh.ctx, md);
+	md_to_str(md, hash);
+	return rc;
+}
+
+static struct sqlite3 *dep_db(int db)
+{
+	if (db == DEP_MEM_DB)
+		return mem_db;
+	return db == DEP_CACHE_DB ? cache_db : smatch_db;
+}
+
+static unsigned long hash_dep_sql(const char *sql)
+{
+	unsigned long hash = 5381;
+
+	while (*sql)
+		hash = ((hash << 5) + hash) + *sql++;
+	return hash % FN_DEP_HASH_SIZE;
+}
+
+static struct fn_dep *find_dep(struct dep_list *list, int db, const char *sql)
+{
+	struct fn_dep *dep;
+
+	for (dep = list->hash[hash_dep_sql(sql)]; dep; dep = dep->hash_next) {
+		if (dep->db == db && strcmp(dep->sql, sql) == 0)
+			return dep;
+	}
+	return NULL;
+}
+
+static void add_dep(struct dep_list *list, int db, const char *sql, const char *hash)
+{
+	struct fn_dep *dep;
+	unsigned long idx;
+
+	dep = calloc(1, sizeof(*dep));
+	if (!dep)
+		sm_fatal("out of memory in the function cache");
+	dep->db = db;
+	dep->sql = strdup(sql);
+	snprintf(dep->hash, sizeof(dep->hash), "%s", hash);
+
+	idx = hash_dep_sql(sql);
+	dep->hash_next = list->hash[idx];
+	list->hash[idx] = dep;
+	*list->tail = dep;
+	list->tail = &dep->next;
+}
+
+static void free_deps(struct fn_dep *dep)
+{
+	struct fn_dep *next;
+
+	for (; dep; dep = next) {
+		next = dep->next;
+		free(dep->sql);
+		free(dep);
+	}
+}
+
+static void reset_deps(struct dep_list *list)
+{
+	list->head = NULL;
+	list->tail = &list->head;
+	memset(list->hash, 0, sizeof(list->hash));
+}
+
+static void append_line(char **buf, size_t *buf_len, size_t *buf_size, const char *str)
+{
+	size_t len = strlen(str);
+
+	if (*buf_len + len + 2 > *buf_size) {
+		*buf_size = *buf_size ? *buf_size : 4096;
+		while (*buf_len + len + 2 > *buf_size)
+			*buf_size *= 2;
+		*buf = realloc(*buf, *buf_size);
+		if (!*buf)
+			sm_fatal("out of memory in the function cache");
+	}
+	memcpy(*buf + *buf_len, str, len);
+	*buf_len += len;
+	if (len && str[len - 1] != '\n')
+		(*buf)[(*buf_len)++] = '\n';
+	(*buf)[*buf_len] = '\0';
+}
+
+static bool is_word_char(char c)
+{
+	return isalnum((unsigned char)c) || c == '_';
+}
+
+/* returns an allocated copy of @str where the word @from is changed to @to */
+static char *replace_word(const char *str, const char *from, const char *to)
+{
+	size_t from_len = strlen(from);
+	size_t to_len = strlen(to);
+	const char *p = str, *match;
+	char *buf, *out;
+
+	if (!from_len)
+		return strdup(str);
+	buf = malloc(strlen(str) + (strlen(str) / from_len + 1) * to_len + 1);
+	if (!buf)
+		sm_fatal("out of memory in the function cache");
+	out = buf;
+	while ((match = strstr(p, from))) {
+		memcpy(out, p, match - p);
+		out += match - p;
+		if ((match == str || !is_word_char(match[-1])) &&
+		    !is_word_char(match[from_len])) {
+			memcpy(out, to, to_len);
+			out += to_len;
+		} else {
+			memcpy(out, from, from_len);
+			out += from_len;
+		}
+		p = match + from_len;
+	}
+	strcpy(out, p);
+	return buf;
+}
+
+/*
+ * The inline results are shared between files and call sites so the file
+ * id and the call id are saved as placeholders.
+ */
+static char *hide_ids(const char *sql)
+{
+	char *tmp, *ret;
+
+	tmp = replace_word(sql, file_id, "%FILE_ID%");
+	ret = replace_word(tmp, call_id, "%CALL_ID%");
+	free(tmp);
+	return ret;
+}
+
+static char *expand_ids(const char *sql)
+{
+	char *tmp, *ret;
+
+	tmp = replace_word(sql, "%FILE_ID%", file_id);
+	ret = replace_word(tmp, "%CALL_ID%", call_id);
+	free(tmp);
+	return ret;
+}
+
+static bool has_word(const char *str, const char *word)
+{
+	char *tmp;
+	bool ret;
+
+	tmp = replace_word(str, word, "");
+	ret = strlen(tmp) != strlen(str);
+	free(tmp);
+	return ret;
+}
+
+static int get_dep_type(struct sqlite3 *db)
+{
+	if (db == mem_db)
+		return DEP_MEM_DB;
+	return db == cache_db ? DEP_CACHE_DB : DEP_SMATCH_DB;
+}
+
+/* the changes to cache_db are done again on replay */
+static void add_replay_sql(struct sqlite3 *db, const char *sql)
+{
+	if (db != cache_db)
+		return;
+	if (recording)
+		append_line(&replay_sql, &replay_len, &replay_size, sql);
+	if (inline_recording)
+		append_line(&inline_cache_sql, &inline_cache_len, &inline_cache_size, sql);
+}
+
+/*
+ * The mtag_data isn't in mem_db, see smatch_mtag_data.c.  The changes are
+ * saved as "<tag> <offset> <type> <value>" lines and the values which
+ * were read are dependencies the same as the queries.
+ */
+void fn_cache_add_mtag_data(const char *key, const char *value)
+{
+	size_t len = strlen(key) + strlen(value) + 1;
+	char *line;
+
+	if (!recording && !inline_recording)
+		return;
+	line = malloc(len);
+	if (!line)
+		sm_fatal("out of memory in the function cache");
+	snprintf(line, len, "%s%s", key, value);
+	if (recording)
+		append_line(&replay_mtag, &replay_mtag_len, &replay_mtag_size, line);
+	if (inline_recording)
+		append_line(&inline_mtag, &inline_mtag_len, &inline_mtag_size, line);
+	free(line);
+}
+
+static void hash_value(const char *value, char *hash)
+{
+	unsigned char md[FN_HASH_SIZE];
+	EVP_MD_CTX *ctx;
+
+	ctx = new_hash_ctx();
+	EVP_DigestUpdate(ctx, value, strlen(value) + 1);
+	finish_hash_ctx(ctx, md);
+	md_to_str(md, hash);
+}
+
+void fn_cache_add_mtag_dep(const char *key, const char *value)
+{
+	char hash[FN_KEY_LEN];
+	bool fn_dep, inline_dep;
+
+	fn_dep = recording && !find_dep(&fn_deps, DEP_MTAG_DATA, key);
+	inline_dep = inline_recording && !find_dep(&inline_deps, DEP_MTAG_DATA, key);
+	if (!fn_dep && !inline_dep)
+		return;
+
+	hash_value(value, hash);
+	if (fn_dep)
+		add_dep(&fn_deps, DEP_MTAG_DATA, key, hash);
+	if (inline_dep)
+		add_dep(&inline_deps, DEP_MTAG_DATA, key, hash);
+}
+
+static void get_inline_name(struct symbol *sym, char *buf, int size)
+{
+	snprintf(buf, size, "%s:%d:%s", stream_name(sym->pos.stream),
+		 sym->pos.line, sym->ident ? sym->ident->name : "");
+}
+
+/* add_inline_function() queues these to be parsed after the function */
+void fn_cache_add_inline(struct symbol *sym)
+{
+	char buf[PATH_MAX];
+
+	if (!recording)
+		return;
+	get_inline_name(sym, buf, sizeof(buf));
+	append_line(&inline_names, &inline_len, &inline_size, buf);
+}
+
+static bool replay_inlines(const char *names)
+{
+	struct symbol_list *found = NULL;
+	char buf[PATH_MAX];
+	struct symbol *sym;
+	const char *p, *end;
+	bool ret = true;
+
+	for (p = names; p && *p; p = end + 1) {
+		end = strchr(p, '\n');
+		if (!end)
+			break;
+		FOR_EACH_PTR(inline_candidates, sym) {
+			get_inline_name(sym, buf, sizeof(buf));
+			if (strlen(buf) == end - p && strncmp(buf, p, end - p) == 0) {
+				add_ptr_list(&found, sym);
+				goto next;
+			}
+		} END_FOR_EACH_PTR(sym);
+		ret = false;
+		goto free;
+next:
+		;
+	}
+
+	FOR_EACH_PTR(found, sym) {
+		add_inline_function(sym);
+	} END_FOR_EACH_PTR(sym);
+free:
+	free_ptr_list(&found);
+	return ret;
+}
+
+bool fn_cache_recording(struct sqlite3 *db)
+{
+	if (!db)
+		return false;
+	if (!recording && !inline_recording)
+		return false;
+	return db == smatch_db || db == cache_db || db == mem_db;
+}
+
+/*
+ * This is used by sql_exec() instead of sqlite3_exec() while we are
+ * recording.  Every row the callback sees goes into the hash.
+ */
+int fn_cache_exec(struct sqlite3 *db, const char *sql,
+		  int (*callback)(void*, int, char**, char**), void *data,
+		  char **err)
+{
+	int dep = get_dep_type(db);
+	bool fn_dep, inline_dep;
+	char hash[FN_KEY_LEN];
+	int rc;
+
+	/*
+	 * Everything in mem_db belongs to the function, except that an inline
+	 * reads the caller_info for its call site which is part of the key.
+	 */
+	if (db == mem_db) {
+		if (inline_recording && !strstr(sql, inline_caller_info))
+			inline_uncacheable = true;
+		return sqlite3_exec(db, sql, callback, data, err);
+	}
+
+	if (strncasecmp(sql, "select", strlen("select")) != 0) {
+		add_replay_sql(db, sql);
+		return sqlite3_exec(db, sql, callback, data, err);
+	}
+
+	fn_dep = recording && !find_dep(&fn_deps, dep, sql);
+	inline_dep = inline_recording && !find_dep(&inline_deps, dep, sql);
+	if (!fn_dep && !inline_dep)
+		return sqlite3_exec(db, sql, callback, data, err);
+
+	rc = hash_query(db, sql, callback, data, err, hash);
+	if (rc != SQLITE_OK) {
+		uncacheable |= fn_dep;
+		inline_uncacheable |= inline_dep;
+		return rc;
+	}
+	if (fn_dep)
+		add_dep(&fn_deps, dep, sql, hash);
+	if (inline_dep)
+		add_dep(&inline_deps, dep, sql, hash);
+	return rc;
+}
+
+/*
+ * For queries which don't go through sql_exec(), either because they were
+ * skipped or because the results were loaded some other way.
+ */
+void fn_cache_add_dep(struct sqlite3 *db, const char *sql)
+{
+	int dep = get_dep_type(db);
+	bool fn_dep, inline_dep;
+	char hash[FN_KEY_LEN];
+
+	if (!fn_cache_recording(db) || db == mem_db)
+		return;
+	fn_dep = recording && !find_dep(&fn_deps, dep, sql);
+	inline_dep = inline_recording && !find_dep(&inline_deps, dep, sql);
+	if (!fn_dep && !inline_dep)
+		return;
+
+	sql_flush_batch(db);
+	if (hash_query(db, sql, NULL, NULL, NULL, hash) != SQLITE_OK) {
+		uncacheable |= fn_dep;
+		inline_uncacheable |= inline_dep;
+		return;
+	}
+	if (fn_dep)
+		add_dep(&fn_deps, dep, sql, hash);
+	if (inline_dep)
+		add_dep(&inline_deps, dep, sql, hash);
+}
+
+void fn_cache_add_insert(struct sqlite3 *db, const char *sql)
+{
+	if (recording && db == cache_db)
+		append_line(&replay_sql, &replay_len, &replay_size, sql);
+	if (!inline_recording)
+		return;
+	/* every file does this for itself */
+	if (strcmp(sql, file_id_insert) == 0)
+		return;
+	/* this is where the inline's return_states go */
+	if (db == cache_db)
+		append_line(&inline_cache_sql, &inline_cache_len, &inline_cache_size, sql);
+	else if (db == mem_db)
+		append_line(&inline_mem_sql, &inline_mem_len, &inline_mem_size, sql);
+}
+
+/*
+ * The queries saved for inlines are shared between files so they have
+ * a placeholder instead of the file id.  If the query still returns the
+ * same rows and we are recording a function then it depends on the query
+ * as well.
+ */
+static bool dep_matches(int dep, const char *saved_sql, const char *old)
+{
+	struct sqlite3 *db = dep_db(dep);
+	char hash[FN_KEY_LEN];
+	const char *value;
+	char *sql;
+	bool ret;
+
+	if (!saved_sql || !old)
+		return false;
+
+	if (dep == DEP_MTAG_DATA) {
+		value = get_mtag_data_value(saved_sql);
+		if (!value)
+			return false;
+		hash_value(value, hash);
+		ret = strcmp(hash, old) == 0;
+		if (ret && recording && !find_dep(&fn_deps, dep, saved_sql))
+			add_dep(&fn_deps, dep, saved_sql, hash);
+		return ret;
+	}
+
+	if (!db)
+		return false;
+	sql = expand_ids(saved_sql);
+	sql_flush_batch(db);
+	ret = hash_query(db, sql, NULL, NULL, NULL, hash) == SQLITE_OK &&
+	      strcmp(hash, old) == 0;
+	if (ret && recording && !find_dep(&fn_deps, dep, sql))
+		add_dep(&fn_deps, dep, sql, hash);
+	free(sql);
+
+	return ret;
+}
+
+static bool deps_match(const char *key)
+{
+	struct sqlite3_stmt *stmt;
+	bool ret = true;
+
+	if (sqlite3_prepare_v2(fn_cache_db, "select db, query, hash from fn_cache_deps where key = ?;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return false;
+	sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+
+	while (sqlite3_step(stmt) == SQLITE_ROW) {
+		if (!dep_matches(sqlite3_column_int(stmt, 0),
+				 (const char *)sqlite3_column_text(stmt, 1),
+				 (const char *)sqlite3_column_text(stmt, 2))) {
+			ret = false;
+			break;
+		}
+	}
+	sqlite3_finalize(stmt);
+
+	return ret;
+}
+
+static bool replay_fn_results(const char *key)
+{
+	struct sqlite3_stmt *stmt;
+	const void *output;
+	const char *sql;
+	bool found = false;
+
+	if (sqlite3_prepare_v2(fn_cache_db, "select output, sql, checks, errors, inlines, mtag_data from fn_cache where key = ?;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return false;
+	sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+
+	if (sqlite3_step(stmt) != SQLITE_ROW) {
+		fn_cache_misses++;
+		goto finalize;
+	}
+	if (!deps_match(key) ||
+	    !replay_inlines((const char *)sqlite3_column_text(stmt, 4))) {
+		fn_cache_stale++;
+		goto finalize;
+	}
+	found = true;
+
+	output = sqlite3_column_blob(stmt, 0);
+	if (output)
+		fwrite(output, 1, sqlite3_column_bytes(stmt, 0), sm_outfd);
+	sql = (const char *)sqlite3_column_text(stmt, 1);
+	if (sql && sql[0])
+		sql_exec(cache_db, NULL, NULL, sql);
+	replay_mtag_data((const char *)sqlite3_column_text(stmt, 5));
+	sm_nr_checks += sqlite3_column_int(stmt, 2);
+	sm_nr_errors += sqlite3_column_int(stmt, 3);
+	fn_cache_hits++;
+
+finalize:
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+bool load_fn_results(struct symbol *sym)
+{
+	FILE *fd;
+
+	if (!fn_cache_db || recording || option_info)
+		return false;
+	if (option_debug || debug_db || local_debug)
+		return false;
+
+	get_fn_key(sym, cur_key);
+	if (replay_fn_results(cur_key))
+		return true;
+
+	fd = open_memstream(&out_buf, &out_size);
+	if (!fd)
+		return false;
+	real_outfd = sm_outfd;
+	sm_outfd = fd;
+	start_checks = sm_nr_checks;
+	start_errors = sm_nr_errors;
+	replay_len = 0;
+	replay_mtag_len = 0;
+	inline_len = 0;
+	uncacheable = false;
+	reset_deps(&fn_deps);
+	recording = true;
+
+	return false;
+}
+
+static void stop_recording(void)
+{
+	recording = false;
+	fclose(sm_outfd);
+	sm_outfd = real_outfd;
+	if (out_size)
+		fwrite(out_buf, 1, out_size, sm_outfd);
+}
+
+void save_fn_results(struct symbol *sym)
+{
+	struct fn_result *result;
+
+	if (!recording)
+		return;
+	stop_recording();
+
+	if (uncacheable) {
+		fn_cache_not_saved++;
+		free_deps(fn_deps.head);
+		free(out_buf);
+		goto out;
+	}
+
+	result = calloc(1, sizeof(*result));
+	if (!result)
+		sm_fatal("out of memory in the function cache");
+	snprintf(result->key, sizeof(result->key), "%s", cur_key);
+	result->output = out_buf;
+	result->output_size = out_size;
+	result->sql = strdup(replay_len ? replay_sql : "");
+	result->mtag_data = strdup(replay_mtag_len ? replay_mtag : "");
+	result->inlines = strdup(inline_len ? inline_names : "");
+	result->checks = sm_nr_checks - start_checks;
+	result->errors = sm_nr_errors - start_errors;
+	result->deps = fn_deps.head;
+	result->next = pending;
+	pending = result;
+out:
+	out_buf = NULL;
+	out_size = 0;
+	reset_deps(&fn_deps);
+}
+
+static void get_inline_key(struct expression *call, char *key)
+{
+	unsigned char md[FN_HASH_SIZE];
+	struct body_hash *body;
+	struct row_hash rh = {};
+	char sql[128];
+
+	body = get_body_hash(call->fn->symbol);
+	inline_file_local = body->file_local;
+
+	rh.ctx = new_hash_ctx();
+	EVP_DigestUpdate(rh.ctx, inline_md, sizeof(inline_md));
+	EVP_DigestUpdate(rh.ctx, body->md, sizeof(body->md));
+	if (inline_file_local)
+		EVP_DigestUpdate(rh.ctx, get_base_file(), strlen(get_base_file()) + 1);
+
+	/* the caller_info for the call site is what the inline starts with */
+	sql_flush_batch(mem_db);
+	snprintf(sql, sizeof(sql),
+		 "select type, parameter, key, value from caller_info where call_id = %s order by rowid;",
+		 call_id);
+	sqlite3_exec(mem_db, sql, hash_row, &rh, NULL);
+	finish_hash_ctx(rh.ctx, md);
+
+	md_to_str(md, key);
+}
+
+static void free_inline_result(struct inline_result *result)
+{
+	free(result->mem_sql);
+	free(result->cache_sql);
+	free(result->mtag_data);
+	free_deps(result->deps);
+	free(result);
+}
+
+static struct inline_result **find_pending_inline(const char *key)
+{
+	struct inline_result **p;
+
+	for (p = &pending_inlines; *p; p = &(*p)->next) {
+		if (strcmp((*p)->key, key) == 0)
+			return p;
+	}
+	return NULL;
+}
+
+static void replay_inline_sql(struct sqlite3 *db, const char *saved_sql)
+{
+	char *sql;
+
+	if (!saved_sql || !saved_sql[0])
+		return;
+	sql = expand_ids(saved_sql);
+	sql_exec(db, NULL, NULL, sql);
+	free(sql);
+}
+
+static bool replay_pending_inline(struct inline_result **p)
+{
+	struct inline_result *result = *p;
+	struct fn_dep *dep;
+
+	for (dep = result->deps; dep; dep = dep->next) {
+		if (!dep_matches(dep->db, dep->sql, dep->hash)) {
+			inline_stale++;
+			*p = result->next;
+			free_inline_result(result);
+			return false;
+		}
+	}
+	replay_inline_sql(mem_db, result->mem_sql);
+	replay_inline_sql(cache_db, result->cache_sql);
+	replay_mtag_data(result->mtag_data);
+	skip_return_ids(result->return_ids);
+	inline_hits++;
+	return true;
+}
+
+static bool replay_inline_results(const char *key)
+{
+	struct inline_result **p;
+	struct sqlite3_stmt *stmt;
+	bool found = false;
+
+	/* the results for this file haven't been written yet */
+	p = find_pending_inline(key);
+	if (p)
+		return replay_pending_inline(p);
+
+	if (sqlite3_prepare_v2(fn_cache_db, "select mem_sql, cache_sql, return_ids, mtag_data from inline_cache where key = ?;",
+			       -1, &stmt, NULL) != SQLITE_OK)
+		return false;
+	sqlite3_bind_text(stmt, 1, key, -1, SQLITE_STATIC);
+
+	if (sqlite3_step(stmt) != SQLITE_ROW) {
+		inline_misses++;
+		goto finalize;
+	}
+	if (!deps_match(key)) {
+		inline_stale++;
+		goto finalize;
+	}
+	found = true;
+
+	replay_inline_sql(mem_db, (const char *)sqlite3_column_text(stmt, 0));
+	replay_inline_sql(cache_db, (const char *)sqlite3_column_text(stmt, 1));
+	replay_mtag_data((const char *)sqlite3_column_text(stmt, 3));
+	skip_return_ids(sqlite3_column_int(stmt, 2));
+	inline_hits++;
+
+finalize:
+	sqlite3_finalize(stmt);
+	return found;
+}
+
+/*
+ * Parsing an inline at a call site puts the return_states and the
+ * return_implies for the call into mem_db.  The same inlines from the
+ * headers get parsed again in every file so the rows are saved and put
+ * back instead.  The key is the inline itself and the caller_info for the
+ * call site.
+ */
+bool load_inline_results(struct expression *call)
+{
+	if (!fn_cache_db || inline_recording)
+		return false;
+	if (option_debug || debug_db || local_debug)
+		return false;
+	/*
+	 * The --tiered cheap pass has the implications turned off so its
+	 * inline results are worse.  Don't save them for the full pass and
+	 * don't bother replaying the full pass results into it either.
+	 */
+	if (tiered_cheap_pass())
+		return false;
+
+	snprintf(file_id, sizeof(file_id), "0x%llx", get_base_file_id());
+	snprintf(file_id_insert, sizeof(file_id_insert),
+		 "insert or ignore into hash_string values (%s, '%s');\n",
+		 file_id, get_base_file());
+	snprintf(call_id, sizeof(call_id), "%lu", (unsigned long)call);
+	snprintf(inline_caller_info, sizeof(inline_caller_info),
+		 "from caller_info where call_id = %lu;", (unsigned long)call);
+
+	get_inline_key(call, inline_key);
+	if (replay_inline_results(inline_key))
+		return true;
+
+	inline_mem_len = 0;
+	inline_cache_len = 0;
+	inline_mtag_len = 0;
+	inline_uncacheable = false;
+	start_return_id = get_return_id();
+	reset_deps(&inline_deps);
+	inline_recording = true;
+
+	return false;
+}
+
+/* the file name only belongs in the results if it was part of the key */
+static bool mentions_base_file(const char *sql)
+{
+	if (inline_file_local)
+		return false;
+	return strstr(sql, get_base_file()) != NULL;
+}
+
+void save_inline_results(struct expression *call)
+{
+	struct inline_result *result;
+	struct fn_dep *dep;
+	char *sql;
+
+	if (!inline_recording)
+		return;
+	inline_recording = false;
+
+	result = calloc(1, sizeof(*result));
+	if (!result)
+		sm_fatal("out of memory in the function cache");
+	snprintf(result->key, sizeof(result->key), "%s", inline_key);
+	result->mem_sql = hide_ids(inline_mem_len ? inline_mem_sql : "");
+	result->cache_sql = hide_ids(inline_cache_len ? inline_cache_sql : "");
+	result->mtag_data = strdup(inline_mtag_len ? inline_mtag : "");
+	result->return_ids = get_return_id() - start_return_id;
+	result->deps = inline_deps.head;
+	reset_deps(&inline_deps);
+
+	if (out_of_memory() || taking_too_long())
+		inline_uncacheable = true;
+	if (mentions_base_file(result->mem_sql) ||
+	    mentions_base_file(result->cache_sql))
+		inline_uncacheable = true;
+	for (dep = result->deps; dep; dep = dep->next) {
+		if (has_word(dep->sql, call_id) || mentions_base_file(dep->sql))
+			inline_uncacheable = true;
+		sql = hide_ids(dep->sql);
+		free(dep->sql);
+		dep->sql = sql;
+	}
+
+	if (inline_uncacheable) {
+		inline_not_saved++;
+		free_inline_result(result);
+		return;
+	}
+
+	result->next = pending_inlines;
+	pending_inlines = result;
+}
+
+static void write_deps(struct sqlite3_stmt *delete, struct sqlite3_stmt *insert_dep,
+		       const char *key, struct fn_dep *deps)
+{
+	struct fn_dep *dep;
+
+	sqlite3_bind_text(delete, 1, key, -1, SQLITE_STATIC);
+	sqlite3_step(delete);
+	sqlite3_reset(delete);
+
+	for (dep = deps; dep; dep = dep->next) {
+		sqlite3_bind_text(insert_dep, 1, key, -1, SQLITE_STATIC);
+		sqlite3_bind_int(insert_dep, 2, dep->db);
+		sqlite3_bind_text(insert_dep, 3, dep->sql, -1, SQLITE_STATIC);
+		sqlite3_bind_text(insert_dep, 4, dep->hash, -1, SQLITE_STATIC);
+		sqlite3_step(insert_dep);
+		sqlite3_reset(insert_dep);
+	}
+}
+
+static void write_result(struct sqlite3_stmt *insert, struct fn_result *result)
+{
+	sqlite3_bind_text(insert, 1, result->key, -1, SQLITE_STATIC);
+	sqlite3_bind_blob(insert, 2, result->output, result->output_size, SQLITE_STATIC);
+	sqlite3_bind_text(insert, 3, result->sql, -1, SQLITE_STATIC);
+	sqlite3_bind_int(insert, 4, result->checks);
+	sqlite3_bind_int(insert, 5, result->errors);
+	sqlite3_bind_text(insert, 6, result->inlines, -1, SQLITE_STATIC);
+	sqlite3_bind_text(insert, 7, result->mtag_data, -1, SQLITE_STATIC);
+	sqlite3_step(insert);
+	sqlite3_reset(insert);
+}
+
+static void write_inline_result(struct sqlite3_stmt *insert, struct inline_result *result)
+{
+	sqlite3_bind_text(insert, 1, result->key, -1, SQLITE_STATIC);
+	sqlite3_bind_text(insert, 2, result->mem_sql, -1, SQLITE_STATIC);
+	sqlite3_bind_text(insert, 3, result->cache_sql, -1, SQLITE_STATIC);
+	sqlite3_bind_int(insert, 4, result->return_ids);
+	sqlite3_bind_text(insert, 5, result->mtag_data, -1, SQLITE_STATIC);
+	sqlite3_step(insert);
+	sqlite3_reset(insert);
+}
+
+/*
+ * The results are written once per file so that parallel smatch processes
+ * only take the write lock for a moment.
+ */
+static void write_pending_results(void)
+{
+	struct sqlite3_stmt *insert = NULL, *insert_inline = NULL;
+	struct sqlite3_stmt *delete = NULL, *insert_dep = NULL;
+	struct fn_result *result, *next;
+	struct inline_result *inline_result, *inline_next;
+
+	if (!pending && !pending_inlines)
+		return;
+
+	if (sqlite3_exec(fn_cache_db, "BEGIN IMMEDIATE;", NULL, NULL, NULL) != SQLITE_OK)
+		goto free;
+	if (sqlite3_prepare_v2(fn_cache_db, "insert or replace into fn_cache values (?, ?, ?, ?, ?, ?, ?);",
+			       -1, &insert, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(fn_cache_db, "insert or replace into inline_cache values (?, ?, ?, ?, ?);",
+			       -1, &insert_inline, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(fn_cache_db, "delete from fn_cache_deps where key = ?;",
+			       -1, &delete, NULL) != SQLITE_OK ||
+	    sqlite3_prepare_v2(fn_cache_db, "insert into fn_cache_deps values (?, ?, ?, ?);",
+			       -1, &insert_dep, NULL) != SQLITE_OK) {
+		sqlite3_exec(fn_cache_db, "ROLLBACK;", NULL, NULL, NULL);
+		goto free;
+	}
+
+	for (result = pending; result; result = result->next) {
+		write_deps(delete, insert_dep, result->key, result->deps);
+		write_result(insert, result);
+	}
+	for (inline_result = pending_inlines; inline_result; inline_result = inline_result->next) {
+		write_deps(delete, insert_dep, inline_result->key, inline_result->deps);
+		write_inline_result(insert_inline, inline_result);
+	}
+	sqlite3_exec(fn_cache_db, "COMMIT;", NULL, NULL, NULL);
+
+free:
+	sqlite3_finalize(insert);
+	sqlite3_finalize(insert_inline);
+	sqlite3_finalize(delete);
+	sqlite3_finalize(insert_dep);
+
+	for (result = pending; result; result = next) {
+		next = result->next;
+		free(result->output);
+		free(result->sql);
+		free(result->mtag_data);
+		free(result->inlines);
+		free_deps(result->deps);
+		free(result);
+	}
+	pending = NULL;
+
+	for (inline_result = pending_inlines; inline_result; inline_result = inline_next) {
+		inline_next = inline_result->next;
+		free_inline_result(inline_result);
+	}
+	pending_inlines = NULL;
+}
+
+static void match_end_file(struct symbol_list *sym_list)
+{
+	write_pending_results();
+	free_body_hashes();
+	free_ptr_list(&inline_candidates);
+}
+
+/* don't lose the output if we die in the middle of a function */
+static void flush_on_exit(void)
+{
+	if (!recording)
+		return;
+	stop_recording();
+	fflush(sm_outfd);
+}
+
+void print_fn_cache_stats(void)
+{
+	unsigned long long total;
+
+	if (!fn_cache_db)
+		return;
+	total = fn_cache_hits + fn_cache_misses + fn_cache_stale;
+	sm_msg("fn cache: %llu%% hit rate.  %llu hits %llu stale %llu misses %llu not saved",
+	       total ? fn_cache_hits * 100 / total : 0,
+	       fn_cache_hits, fn_cache_stale, fn_cache_misses, fn_cache_not_saved);
+	total = inline_hits + inline_misses + inline_stale;
+	sm_msg("inline cache: %llu%% hit rate.  %llu hits %llu stale %llu misses %llu not saved",
+	       total ? inline_hits * 100 / total : 0,
+	       inline_hits, inline_stale, inline_misses, inline_not_saved);
+}
+
+void fn_cache_save_args(int argc, char **argv)
+{
+	EVP_MD_CTX *ctx;
+	int i;
+
+	ctx = new_hash_ctx();
+	for (i = 1; i < argc; i++)
+		EVP_DigestUpdate(ctx, argv[i], strlen(argv[i]) + 1);
+	finish_hash_ctx(ctx, args_md);
+
+	/*
+	 * The inline results are shared between files so they only use the
+	 * smatch options at the start.  The compiler options change the code
+	 * and that is already part of the key.
+	 */
+	ctx = new_hash_ctx();
+	for (i = 1; i < argc; i++) {
+		if (strncmp(argv[i], "--", 2) != 0 &&
+		    strncmp(argv[i], "-p=", 3) != 0)
+			break;
+		if (strncmp(argv[i], "--fn-cache=", 11) == 0 ||
+		    strncmp(argv[i], "--db-file=", 10) == 0)
+			continue;
+		EVP_DigestUpdate(ctx, argv[i], strlen(argv[i]) + 1);
+	}
+	finish_hash_ctx(ctx, smatch_args_md);
+}
+
+static void hash_file(EVP_MD_CTX *ctx, const char *filename)
+{
+	char buf[4096];
+	FILE *fd;
+	size_t len;
+
+	fd = fopen(filename, "r");
+	if (!fd)
+		return;
+	while ((len = fread(buf, 1, sizeof(buf), fd)) > 0)
+		EVP_DigestUpdate(ctx, buf, len);
+	fclose(fd);
+}
+
+static void hash_data_dir(EVP_MD_CTX *ctx)
+{
+	char path[PATH_MAX];
+	struct dirent *entry;
+	struct stat st;
+	DIR *dir;
+
+	if (option_no_data || !data_dir)
+		return;
+	dir = opendir(data_dir);
+	if (!dir)
+		return;
+	while ((entry = readdir(dir))) {
+		snprintf(path, sizeof(path), "%s/%s", data_dir, entry->d_name);
+		if (stat(path, &st) != 0 || !S_ISREG(st.st_mode))
+			continue;
+		EVP_DigestUpdate(ctx, entry->d_name, strlen(entry->d_name) + 1);
+		EVP_DigestUpdate(ctx, &st.st_size, sizeof(st.st_size));
+		EVP_DigestUpdate(ctx, &st.st_mtime, sizeof(st.st_mtime));
+	}
+	closedir(dir);
+}
+
+static int get_user_version(void *_version, int argc, char **argv, char **azColName)
+{
+	int *version = _version;
+
+	if (argc == 1 && argv[0])
+		*version = atoi(argv[0]);
+	return 0;
+}
+
+/* it's only a cache so if the format changed then start over */
+static bool check_fn_cache_version(void)
+{
+	const char *drop =
+		"BEGIN IMMEDIATE;"
+		"DROP TABLE IF EXISTS fn_cache;"
+		"DROP TABLE IF EXISTS inline_cache;"
+		"DROP TABLE IF EXISTS fn_cache_deps;"
+		"PRAGMA user_version = " FN_CACHE_VERSION ";"
+		"COMMIT;";
+	int version = 0;
+
+	if (sqlite3_exec(fn_cache_db, "PRAGMA user_version;", get_user_version, &version, NULL) != SQLITE_OK)
+		return false;
+	if (version == atoi(FN_CACHE_VERSION))
+		return true;
+	return sqlite3_exec(fn_cache_db, drop, NULL, NULL, NULL) == SQLITE_OK;
+}
+
+static bool open_fn_cache(void)
+{
+	const char *schema =
+		"PRAGMA journal_mode = WAL;"
+		"PRAGMA synchronous = OFF;"
+		"CREATE TABLE IF NOT EXISTS fn_cache (key text primary key, output blob, sql text, checks integer, errors integer, inlines text, mtag_data text);"
+		"CREATE TABLE IF NOT EXISTS inline_cache (key text primary key, mem_sql text, cache_sql text, return_ids integer, mtag_data text);"
+		"CREATE TABLE IF NOT EXISTS fn_cache_deps (key text, db integer, query text, hash text);"
+		"CREATE INDEX IF NOT EXISTS fn_cache_deps_idx on fn_cache_deps (key);";
+
+	if (sqlite3_open(option_fn_cache, &fn_cache_db) != SQLITE_OK)
+		goto fail;
+	sqlite3_busy_timeout(fn_cache_db, 60000);
+	if (!check_fn_cache_version())
+		goto fail;
+	if (sqlite3_exec(fn_cache_db, schema, NULL, NULL, NULL) != SQLITE_OK)
+		goto fail;
+	return true;
+fail:
+	sqlite3_close(fn_cache_db);
+	fn_cache_db = NULL;
+	return false;
+}
+
+void register_fn_cache(int id)
+{
+	unsigned char env_md[FN_HASH_SIZE];
+	EVP_MD_CTX *ctx;
+
+	if (!option_fn_cache)
+		return;
+	if (!open_fn_cache())
+		return;
+
+	ctx = new_hash_ctx();
+	EVP_DigestUpdate(ctx, sparse_version, strlen(sparse_version));
+	EVP_DigestUpdate(ctx, &option_no_db, sizeof(option_no_db));
+	hash_file(ctx, "/proc/self/exe");
+	hash_data_dir(ctx);
+	finish_hash_ctx(ctx, env_md);
+
+	ctx = new_hash_ctx();
+	EVP_DigestUpdate(ctx, env_md, sizeof(env_md));
+	EVP_DigestUpdate(ctx, args_md, sizeof(args_md));
+	finish_hash_ctx(ctx, global_md);
+
+	ctx = new_hash_ctx();
+	EVP_DigestUpdate(ctx, env_md, sizeof(env_md));
+	EVP_DigestUpdate(ctx, smatch_args_md, sizeof(smatch_args_md));
+	finish_hash_ctx(ctx, inline_md);
+
+	atexit(flush_on_exit);
+	add_hook(&match_end_file, END_FILE_HOOK);
+}
@@ -63,6 +63,27 @@
 
 char *implied_debug_msg;
 
+/*
+ * The pools for a condition only depend on the gate sm_state and the
+ * condition.  Conditions like "if (ret)" get checked over and over after the
+ * same function call so we save what separate_pools() found.  The ->pool of
+ * an sm_state is only set once and fake history gives the same answer the
+ * second time so the saved pools stay valid until the sm_states are freed at
+ * the end of the function.
+ */
+struct implied_memo {
+	struct sm_state *sm;
+	int comparison;
+	struct range_list *rl;
+	int mixed_in;
+	int mixed_out;
+	struct state_list *true_stack;
+	struct state_list *false_stack;
+	struct implied_memo *next;
+};
+ALLOCATOR(implied_memo, "implication memos");
+static struct implied_memo *implied_memos[1024];
+
 bool implications_off;
 
 bool implied_debug;
@@ -424,6 +445,65 @@ static void separate_pools(struct sm_state *sm, int comparison, struct range_lis
 	} END_FOR_EACH_PTR(tmp);
 }
 
+static int get_mixed_in(int *mixed)
+{
+	if (!mixed)
+		return -1;
+	return *mixed;
+}
+
+static struct implied_memo **get_memo_bucket(struct sm_state *sm)
+{
+	return &implied_memos[((unsigned long)sm >> 4) % ARRAY_SIZE(implied_memos)];
+}
+
+static struct implied_memo *get_implied_memo(struct sm_state *sm, int comparison,
+					     struct range_list *rl, int *mixed)
+{
+	struct implied_memo *memo;
+
+	for (memo = *get_memo_bucket(sm); memo; memo = memo->next) {
+		if (memo->sm == sm &&
+		    memo->comparison == comparison &&
+		    memo->mixed_in == get_mixed_in(mixed) &&
+		    rl_type(memo->rl) == rl_type(rl) &&
+		    rl_equiv(memo->rl, rl))
+			return memo;
+	}
+	return NULL;
+}
+
+static struct implied_memo *add_implied_memo(struct sm_state *sm, int comparison,
+					     struct range_list *rl, int *mixed)
+{
+	struct implied_memo **bucket = get_memo_bucket(sm);
+	struct implied_memo *memo;
+
+	memo = __alloc_implied_memo(0);
+	memo->sm = sm;
+	memo->comparison = comparison;
+	memo->rl = rl;
+	memo->mixed_in = get_mixed_in(mixed);
+	memo->next = *bucket;
+	*bucket = memo;
+	return memo;
+}
+
+static void free_implied_memos(void)
+{
+	struct implied_memo *memo;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(implied_memos); i++) {
+		for (memo = implied_memos[i]; memo; memo = memo->next) {
+			free_slist(&memo->true_stack);
+			free_slist(&memo->false_stack);
+		}
+		implied_memos[i] = NULL;
+	}
+	clear_implied_memo_alloc();
+}
+
 static int sm_in_keep_leafs(struct sm_state *sm, const struct state_list *keep_gates)
 {
 	struct sm_state *tmp, *old;
@@ -444,7 +524,7 @@ static int going_too_slow(void)
 {
 	static void *printed;
 
-	if (out_of_memory()) {
+	if (out_of_memory() || tiered_cheap_pass()) {
 		implications_off = true;
 		return 1;
 	}
@@ -630,6 +710,7 @@ static void separate_and_filter(struct sm_state *sm, int comparison, struct rang
 {
 	struct state_list *true_stack = NULL;
 	struct state_list *false_stack = NULL;
+	struct implied_memo *memo = NULL;
 	struct timeval time_before;
 	struct timeval time_after;
 	int sec;
@@ -644,7 +725,20 @@ static void separate_and_filter(struct sm_state *sm, int comparison, struct rang
 		return;
 	}
 
-	separate_pools(sm, comparison, rl, &true_stack, &false_stack, NULL, mixed);
+	if (!full_debug)
+		memo = get_implied_memo(sm, comparison, rl, mixed);
+	if (memo) {
+		true_stack = memo->true_stack;
+		false_stack = memo->false_stack;
+		if (mixed)
+			*mixed = memo->mixed_out;
+	} else {
+		separate_pools(sm, comparison, rl, &true_stack, &false_stack, NULL, mixed);
+		memo = add_implied_memo(sm, comparison, rl, mixed);
+		memo->true_stack = true_stack;
+		memo->false_stack = false_stack;
+		memo->mixed_out = mixed ? *mixed : 0;
+	}
 
 	if (full_debug) {
 		struct sm_state *sm;
@@ -662,8 +756,6 @@ static void separate_and_filter(struct sm_state *sm, int comparison, struct rang
 	*true_states = filter_stack(sm, pre_stree, false_stack, true_stack);
 	DIMPLIED("filtering false stack.\n");
 	*false_states = filter_stack(sm, pre_stree, true_stack, false_stack);
-	free_slist(&true_stack);
-	free_slist(&false_stack);
 
 	gettimeofday(&time_after, NULL);
 	sec = time_after.tv_sec - time_before.tv_sec;
@@ -1146,6 +1238,13 @@ struct stree *__implied_case_stree(struct expression *switch_expr,
 	return ret;
 }
 
+static void match_func_def(struct symbol *sym)
+{
+	if (__inline_fn)
+		return;
+	free_implied_memos();
+}
+
 static void match_end_func(struct symbol *sym)
 {
 	if (__inline_fn)
@@ -1267,5 +1366,6 @@ void register_implications(int id)
 	add_hook(&__comparison_match_condition, CONDITION_HOOK);
 	add_hook(&set_extra_implied_states, CONDITION_HOOK);
 	add_hook(&__stored_condition, CONDITION_HOOK);
+	add_hook(&match_func_def, FUNC_DEF_HOOK);
 	add_hook(&match_end_func, END_FUNC_HOOK);
 }
@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * With --info --info-frames the SQL lines are not printed as
+ *
+ *	file.c:12 frob() SQL: insert into ...
+ *
+ * but as length prefixed records.  The file and function are only
+ * printed when they change.  Every record starts with a 0x1e byte so the
+ * warnings and "info:" lines, which are still printed as text, can be
+ * told apart:
+ *
+ *	\x1e F <len> : <file> \0 <function> \n
+ *	\x1e S <len> : <line> <sql> \n		SQL:
+ *	\x1e L <len> : <line> <sql> \n		SQL_late:
+ *	\x1e C <len> : <line> <sql> \n		SQL_caller_info:
+ *
+ * <len> is the number of bytes between the ':' and the '\n' so the SQL
+ * can contain any character.  smatch_data/db/unframe_info.pl converts
+ * the output back to the text format.
+ */
+
+#include <stdarg.h>
+#include "smatch.h"
+
+#define FRAME_BUF_SIZE (1 << 20)
+
+int option_info_frames;
+
+struct frame_fd {
+	FILE *fd;
+	char *file;
+	char *function;
+};
+
+static struct frame_fd frame_fds[4];
+
+static char *row_buf;
+static int row_size;
+
+static struct frame_fd *get_frame_fd(FILE *fd, bool *new)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(frame_fds); i++) {
+		if (frame_fds[i].fd == fd)
+			return &frame_fds[i];
+	}
+	for (i = 0; i < ARRAY_SIZE(frame_fds); i++) {
+		if (!frame_fds[i].fd) {
+			frame_fds[i].fd = fd;
+			if (new)
+				*new = true;
+			return &frame_fds[i];
+		}
+	}
+	return NULL;
+}
+
+void info_frames_new_fd(FILE *fd)
+{
+	bool new = false;
+
+	if (!option_info || !option_info_frames)
+		return;
+
+	/* the SQL is the bulk of the output so buffer it in big chunks */
+	if (get_frame_fd(fd, &new) && new)
+		setvbuf(fd, NULL, _IOFBF, FRAME_BUF_SIZE);
+}
+
+static void print_header(FILE *fd)
+{
+	struct frame_fd *frame;
+	const char *file = get_filename();
+	const char *function = get_function();
+
+	/* this is what the text format prints */
+	if (!function)
+		function = "(null)";
+
+	frame = get_frame_fd(fd, NULL);
+	if (frame && frame->file &&
+	    strcmp(frame->file, file) == 0 &&
+	    strcmp(frame->function, function) == 0)
+		return;
+
+	fprintf(fd, "\x1e" "F%zu:%s", strlen(file) + 1 + strlen(function), file);
+	fputc('\0', fd);
+	fprintf(fd, "%s\n", function);
+
+	if (!frame)
+		return;
+	free(frame->file);
+	free(frame->function);
+	frame->file = strdup(file);
+	frame->function = strdup(function);
+}
+
+static int row_vprintf(int pos, const char *fmt, va_list args)
+{
+	va_list copy;
+	int len;
+
+	va_copy(copy, args);
+	len = vsnprintf(row_buf + pos, row_size - pos, fmt, copy);
+	va_end(copy);
+	if (pos + len < row_size)
+		return len;
+
+	row_size = pos + len + 1024;
+	row_buf = realloc(row_buf, row_size);
+	if (!row_buf)
+		sm_fatal("out of memory");
+	return vsnprintf(row_buf + pos, row_size - pos, fmt, args);
+}
+
+static int row_printf(int pos, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	va_start(args, fmt);
+	len = row_vprintf(pos, fmt, args);
+	va_end(args);
+
+	return len;
+}
+
+void print_info_frame(FILE *fd, char type, const char *ignore,
+		      const char *table, const char *fmt, ...)
+{
+	va_list args;
+	int len;
+
+	len = row_printf(0, "%d ", get_lineno());
+	/* sql_insert() only passes the values */
+	if (table)
+		len += row_printf(len, "insert %sinto %s values(", ignore, table);
+	va_start(args, fmt);
+	len += row_vprintf(len, fmt, args);
+	va_end(args);
+	if (table)
+		len += row_printf(len, ");");
+
+	print_header(fd);
+	fprintf(fd, "\x1e%c%d:", type, len);
+	fwrite(row_buf, 1, len, fd);
+	fputc('\n', fd);
+}
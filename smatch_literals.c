@@ -0,0 +1,452 @@
+/*
+ * Copyright (C) 2015 Rasmus Villemoes.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * Kernel code passes the same string literals around over and over.  The
+ * same printk() format is expanded through a dozen macros and the same
+ * "%s" is handed to sprintf() all over the place.  Everything we know
+ * about a literal is stored here so it only has to be worked out once per
+ * file.  The literals are interned by their text, and there is a second
+ * table keyed by the struct string pointer so the common case doesn't
+ * have to hash the text again.
+ */
+
+#define _GNU_SOURCE
+
+#include <ctype.h>
+#include <string.h>
+#include "smatch.h"
+#include "smatch_literals.h"
+
+extern char __check_printf_spec[1-2*(sizeof(struct printf_spec) != 8)];
+
+#define LITERAL_HASH_BITS 12
+#define LITERAL_HASH_SIZE (1 << LITERAL_HASH_BITS)
+
+struct literal_ref {
+	struct string *string;
+	struct literal_info *info;
+	struct literal_ref *next;
+};
+
+ALLOCATOR(literal_info, "string literal info");
+ALLOCATOR(literal_ref, "string literal refs");
+
+static struct literal_info *text_hash[LITERAL_HASH_SIZE];
+static struct literal_ref *ptr_hash[LITERAL_HASH_SIZE];
+
+static unsigned int hash_text(struct string *string)
+{
+	unsigned long hash = 5381;
+	int i;
+
+	for (i = 0; i < string->length; i++)
+		hash = ((hash << 5) + hash) + (unsigned char)string->data[i];
+
+	return hash & (LITERAL_HASH_SIZE - 1);
+}
+
+static unsigned int hash_ptr(struct string *string)
+{
+	unsigned long hash = (unsigned long)string;
+
+	hash ^= hash >> 4;
+	hash ^= hash >> LITERAL_HASH_BITS;
+	return hash & (LITERAL_HASH_SIZE - 1);
+}
+
+static bool same_text(struct string *a, struct string *b)
+{
+	if (a->length != b->length)
+		return false;
+	return memcmp(a->data, b->data, a->length) == 0;
+}
+
+static struct literal_info *intern_literal(struct string *string)
+{
+	struct literal_info *info;
+	unsigned int hash;
+
+	hash = hash_text(string);
+	for (info = text_hash[hash]; info; info = info->next) {
+		if (same_text(info->string, string))
+			return info;
+	}
+
+	info = __alloc_literal_info(0);
+	info->string = string;
+	info->strlen = strnlen(string->data, string->length);
+	/* string->length counts the NUL on the end */
+	info->embedded_nul = string->length && info->strlen < string->length - 1;
+	info->next = text_hash[hash];
+	text_hash[hash] = info;
+
+	return info;
+}
+
+struct literal_info *get_literal_info(struct string *string)
+{
+	struct literal_ref *ref;
+	unsigned int hash;
+
+	if (!string)
+		return NULL;
+
+	hash = hash_ptr(string);
+	for (ref = ptr_hash[hash]; ref; ref = ref->next) {
+		if (ref->string == string)
+			return ref->info;
+	}
+
+	ref = __alloc_literal_ref(0);
+	ref->string = string;
+	ref->info = intern_literal(string);
+	ref->next = ptr_hash[hash];
+	ptr_hash[hash] = ref;
+
+	return ref->info;
+}
+
+/*
+ * Much of this is taken directly from the kernel (mostly vsprintf.c),
+ * with a few modifications here and there.
+ */
+
+static int
+skip_atoi(const char **s)
+{
+	int i = 0;
+
+	while (isdigit(**s))
+		i = i*10 + *((*s)++) - '0';
+
+	return i;
+}
+
+static int
+format_decode(const char *fmt, struct format_spec *fs)
+{
+	struct printf_spec *spec = &fs->spec;
+	const char *start = fmt;
+	char qualifier;
+
+	fs->warn = FORMAT_WARN_NONE;
+	fs->qualifier = 0;
+
+	/* we finished early by reading the field width */
+	if (spec->type == FORMAT_TYPE_WIDTH) {
+		if (spec->field_width < 0) {
+			spec->field_width = -spec->field_width;
+			spec->flags |= FMT_LEFT;
+		}
+		spec->type = FORMAT_TYPE_NONE;
+		goto precision;
+	}
+
+	/* we finished early by reading the precision */
+	if (spec->type == FORMAT_TYPE_PRECISION) {
+		if (spec->precision < 0)
+			spec->precision = 0;
+
+		spec->type = FORMAT_TYPE_NONE;
+		goto qualifier;
+	}
+
+	/* By default */
+	spec->type = FORMAT_TYPE_NONE;
+
+	for (; *fmt ; ++fmt) {
+		if (*fmt == '%')
+			break;
+	}
+
+	/* Return the current non-format string */
+	if (fmt != start || !*fmt)
+		return fmt - start;
+
+	/* Process flags */
+	spec->flags = 0;
+
+	while (1) { /* this also skips first '%' */
+		bool found = true;
+
+		++fmt;
+
+		switch (*fmt) {
+		case '-': spec->flags |= FMT_LEFT;    break;
+		case '+': spec->flags |= FMT_PLUS;    break;
+		case ' ': spec->flags |= FMT_SPACE;   break;
+		case '#': spec->flags |= FMT_SPECIAL; break;
+		case '0': spec->flags |= FMT_ZEROPAD; break;
+		default:  found = false;
+		}
+
+		if (!found)
+			break;
+	}
+
+	/* get field width */
+	spec->field_width = -1;
+
+	if (isdigit(*fmt))
+		spec->field_width = skip_atoi(&fmt);
+	else if (*fmt == '*') {
+		/* it's the next argument */
+		spec->type = FORMAT_TYPE_WIDTH;
+		return ++fmt - start;
+	}
+
+precision:
+	/* get the precision */
+	spec->precision = -1;
+	if (*fmt == '.') {
+		++fmt;
+		if (isdigit(*fmt)) {
+			spec->precision = skip_atoi(&fmt);
+			if (spec->precision < 0)
+				spec->precision = 0;
+		} else if (*fmt == '*') {
+			/* it's the next argument */
+			spec->type = FORMAT_TYPE_PRECISION;
+			return ++fmt - start;
+		}
+	}
+
+qualifier:
+	/* get the conversion qualifier */
+	qualifier = 0;
+	if (*fmt == 'h' || _tolower(*fmt) == 'l' ||
+	    _tolower(*fmt) == 'z' || *fmt == 't') {
+		qualifier = *fmt++;
+		if (qualifier == *fmt) {
+			if (qualifier == 'l') {
+				qualifier = 'L';
+				++fmt;
+			} else if (qualifier == 'h') {
+				qualifier = 'H';
+				++fmt;
+			} else {
+				fs->warn = FORMAT_WARN_REPEATED_QUALIFIER;
+				fs->qualifier = *fmt;
+			}
+		}
+	}
+
+	/* default base */
+	spec->base = 10;
+	switch (*fmt) {
+	case 'c':
+		if (qualifier) {
+			fs->warn = FORMAT_WARN_CHAR_QUALIFIER;
+			fs->qualifier = qualifier;
+		}
+
+		spec->type = FORMAT_TYPE_CHAR;
+		return ++fmt - start;
+
+	case 's':
+		if (qualifier && qualifier != 'l') {
+			fs->warn = FORMAT_WARN_STR_QUALIFIER;
+			fs->qualifier = qualifier;
+		}
+
+		spec->type = FORMAT_TYPE_STR;
+		return ++fmt - start;
+
+	case 'p':
+		spec->type = FORMAT_TYPE_PTR;
+		return ++fmt - start;
+
+	case '%':
+		spec->type = FORMAT_TYPE_PERCENT_CHAR;
+		return ++fmt - start;
+
+	/* integer number formats - set up the flags and "break" */
+	case 'o':
+		spec->base = 8;
+		break;
+
+	case 'x':
+		spec->flags |= FMT_SMALL;
+
+	case 'X':
+		spec->base = 16;
+		break;
+
+	case 'd':
+	case 'i':
+		spec->flags |= FMT_SIGN;
+	case 'u':
+		break;
+
+	case 'n':
+		spec->type = FORMAT_TYPE_NRCHARS;
+		return ++fmt - start;
+
+	case 'a': case 'A':
+	case 'e': case 'E':
+	case 'f': case 'F':
+	case 'g': case 'G':
+		spec->type = FORMAT_TYPE_FLOAT;
+		return ++fmt - start;
+
+	default:
+		spec->type = FORMAT_TYPE_INVALID;
+		/* Unlike the kernel code, we 'consume' the invalid
+		 * character so that it can get included in the
+		 * report. After that, we bail out. */
+		return ++fmt - start;
+	}
+
+	if (qualifier == 'L')
+		spec->type = FORMAT_TYPE_LONG_LONG;
+	else if (qualifier == 'l') {
+		if (spec->flags & FMT_SIGN)
+			spec->type = FORMAT_TYPE_LONG;
+		else
+			spec->type = FORMAT_TYPE_ULONG;
+	} else if (_tolower(qualifier) == 'z') {
+		spec->type = FORMAT_TYPE_SIZE_T;
+	} else if (qualifier == 't') {
+		spec->type = FORMAT_TYPE_PTRDIFF;
+	} else if (qualifier == 'H') {
+		if (spec->flags & FMT_SIGN)
+			spec->type = FORMAT_TYPE_BYTE;
+		else
+			spec->type = FORMAT_TYPE_UBYTE;
+	} else if (qualifier == 'h') {
+		if (spec->flags & FMT_SIGN)
+			spec->type = FORMAT_TYPE_SHORT;
+		else
+			spec->type = FORMAT_TYPE_USHORT;
+	} else {
+		if (spec->flags & FMT_SIGN)
+			spec->type = FORMAT_TYPE_INT;
+		else
+			spec->type = FORMAT_TYPE_UINT;
+	}
+
+	return ++fmt - start;
+}
+
+static void parse_format_specs(struct literal_info *info)
+{
+	struct format_spec fs = {};
+	const char *data, *fmt, *end;
+	int size = 0;
+
+	info->specs_parsed = true;
+
+	data = fmt = info->string->data;
+	end = data + info->string->length;
+	while (fmt < end && *fmt) {
+		fs.offset = fmt - data;
+		fs.len = format_decode(fmt, &fs);
+		fmt += fs.len;
+
+		fs.ext_len = 0;
+		if (fs.spec.type == FORMAT_TYPE_PTR) {
+			while (isalnum(fmt[fs.ext_len]))
+				fs.ext_len++;
+			fmt += fs.ext_len;
+		}
+
+		if (info->nr_specs == size) {
+			size = size ? size * 2 : 8;
+			info->specs = realloc(info->specs, size * sizeof(*info->specs));
+			if (!info->specs)
+				sm_fatal("out of memory parsing '%s'", data);
+		}
+		info->specs[info->nr_specs++] = fs;
+
+		/* a trailing "%" consumes the NUL so there is nothing after it */
+		if (fs.spec.type == FORMAT_TYPE_INVALID)
+			break;
+	}
+}
+
+/*
+ * Returns the format_decode() steps for the string in order.  The spec
+ * in each step is the state after that call so it includes the
+ * FORMAT_TYPE_WIDTH and FORMAT_TYPE_PRECISION steps.
+ */
+struct format_spec *get_literal_format_specs(struct string *string, int *nr)
+{
+	struct literal_info *info;
+
+	info = get_literal_info(string);
+	if (!info) {
+		*nr = 0;
+		return NULL;
+	}
+	if (!info->specs_parsed)
+		parse_format_specs(info);
+
+	*nr = info->nr_specs;
+	return info->specs;
+}
+
+const char *get_escaped_literal(struct string *string)
+{
+	struct literal_info *info;
+
+	info = get_literal_info(string);
+	if (!info)
+		return NULL;
+	if (!info->escaped)
+		info->escaped = strdup(escape_newlines(string->data));
+	return info->escaped;
+}
+
+bool is_string_literal(struct expression *expr, const char *str)
+{
+	struct literal_info *info;
+
+	expr = strip_expr(expr);
+	if (!expr || expr->type != EXPR_STRING)
+		return false;
+
+	info = get_literal_info(expr->string);
+	if (!info || info->embedded_nul)
+		return false;
+	if (info->strlen != strlen(str))
+		return false;
+	return strcmp(info->string->data, str) == 0;
+}
+
+static void match_end_file(struct symbol_list *sym_list)
+{
+	struct literal_info *info;
+	int i;
+
+	for (i = 0; i < LITERAL_HASH_SIZE; i++) {
+		for (info = text_hash[i]; info; info = info->next) {
+			free(info->specs);
+			free(info->escaped);
+		}
+	}
+
+	memset(text_hash, 0, sizeof(text_hash));
+	memset(ptr_hash, 0, sizeof(ptr_hash));
+	clear_literal_info_alloc();
+	clear_literal_ref_alloc();
+}
+
+void register_literals(int id)
+{
+	add_hook(&match_end_file, END_FILE_HOOK);
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2015 Rasmus Villemoes.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+#ifndef   	SMATCH_LITERALS_H_
+#define   	SMATCH_LITERALS_H_
+
+#define FMT_SIGN	1		/* unsigned/signed, must be 1 */
+#define FMT_LEFT	2		/* left justified */
+#define FMT_PLUS	4		/* show plus */
+#define FMT_SPACE	8		/* space if plus */
+#define FMT_ZEROPAD	16		/* pad with zero, must be 16 == '0' - ' ' */
+#define FMT_SMALL	32		/* use lowercase in hex (must be 32 == 0x20) */
+#define FMT_SPECIAL	64		/* prefix hex with "0x", octal with "0" */
+
+enum format_type {
+	FORMAT_TYPE_NONE, /* Just a string part */
+	FORMAT_TYPE_WIDTH,
+	FORMAT_TYPE_PRECISION,
+	FORMAT_TYPE_CHAR,
+	FORMAT_TYPE_STR,
+	FORMAT_TYPE_PTR,
+	FORMAT_TYPE_PERCENT_CHAR,
+	FORMAT_TYPE_INVALID,
+	FORMAT_TYPE_LONG_LONG,
+	FORMAT_TYPE_ULONG,
+	FORMAT_TYPE_LONG,
+	FORMAT_TYPE_UBYTE,
+	FORMAT_TYPE_BYTE,
+	FORMAT_TYPE_USHORT,
+	FORMAT_TYPE_SHORT,
+	FORMAT_TYPE_UINT,
+	FORMAT_TYPE_INT,
+	FORMAT_TYPE_SIZE_T,
+	FORMAT_TYPE_PTRDIFF,
+	FORMAT_TYPE_NRCHARS, /* Reintroduced for this checker */
+	FORMAT_TYPE_FLOAT, /* for various floating point formatters */
+};
+
+struct printf_spec {
+	unsigned int	type:8;		/* format_type enum */
+	signed int	field_width:24;	/* width of output field */
+	unsigned int	flags:8;	/* flags to number() */
+	unsigned int	base:8;		/* number base, 8, 10 or 16 only */
+	signed int	precision:16;	/* # of digits/chars */
+};
+#define FIELD_WIDTH_MAX ((1 << 23) - 1)
+#define PRECISION_MAX ((1 << 15) - 1)
+
+/*
+ * format_decode() used to print these directly.  Now that the decoded
+ * specs are shared between every call which uses the same literal, the
+ * warning is recorded and the caller prints it.
+ */
+enum format_warning {
+	FORMAT_WARN_NONE,
+	FORMAT_WARN_REPEATED_QUALIFIER,
+	FORMAT_WARN_CHAR_QUALIFIER,
+	FORMAT_WARN_STR_QUALIFIER,
+};
+
+struct format_spec {
+	struct printf_spec spec;
+	int offset;		/* where format_decode() started */
+	int len;		/* what format_decode() consumed */
+	int ext_len;		/* the alnum %p extension after a FORMAT_TYPE_PTR */
+	unsigned char warn;	/* enum format_warning */
+	char qualifier;
+};
+
+struct literal_info {
+	struct string *string;	/* the first string with this text */
+	int strlen;		/* the chars before the first NUL */
+	bool embedded_nul;
+	bool specs_parsed;
+	int nr_specs;
+	struct format_spec *specs;
+	char *escaped;
+	struct literal_info *next;
+};
+
+struct literal_info *get_literal_info(struct string *string);
+struct format_spec *get_literal_format_specs(struct string *string, int *nr);
+const char *get_escaped_literal(struct string *string);
+bool is_string_literal(struct expression *expr, const char *str);
+
+#endif
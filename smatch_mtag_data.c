@@ -28,21 +28,151 @@
 static int my_id;
 static struct stree *vals;
 
-static int save_rl(void *_rl, int argc, char **argv, char **azColName)
+/*
+ * The values are kept in a hash table keyed on (tag, offset, type).  The
+ * value is saved as a string because that's what the function cache
+ * saves and replays and it's what goes into the DB at the end of the file.
+ * The range list is parsed when it's needed and kept until the value
+ * changes.
+ */
+#define MTAG_DATA_HASH_SIZE 4096
+
+struct mtag_value {
+	mtag_t tag;
+	int offset;
+	int type;
+	char *value;
+	struct symbol *rl_type;
+	struct range_list *rl;
+	struct mtag_value *next;
+	struct mtag_value *list_next;
+};
+
+static struct mtag_value *mtag_values[MTAG_DATA_HASH_SIZE];
+static struct mtag_value *value_list, **value_tail = &value_list;
+
+static unsigned int mtag_value_hash(mtag_t tag, int offset, int type)
 {
-	unsigned long *rl = _rl;
+	unsigned long long hash = tag;
 
-	*rl = strtoul(argv[0], NULL, 10);
-	return 0;
+	hash = hash * 31 + offset;
+	hash = hash * 31 + type;
+	return (hash ^ (hash >> 32)) % MTAG_DATA_HASH_SIZE;
 }
 
-static struct range_list *select_orig(mtag_t tag, int offset)
+static struct mtag_value *find_mtag_value(mtag_t tag, int offset, int type)
 {
-	struct range_list *rl = NULL;
+	struct mtag_value *tmp;
 
-	mem_sql(&save_rl, &rl, "select value from mtag_data where tag = %lld and offset = %d;",
-		tag, offset);
-	return rl;
+	for (tmp = mtag_values[mtag_value_hash(tag, offset, type)]; tmp; tmp = tmp->next) {
+		if (tmp->tag == tag && tmp->offset == offset && tmp->type == type)
+			return tmp;
+	}
+	return NULL;
+}
+
+static void set_mtag_value(mtag_t tag, int offset, int type, const char *value)
+{
+	struct mtag_value *tmp;
+	char buf[64];
+	unsigned int idx;
+
+	if (fn_cache_recording(mem_db)) {
+		snprintf(buf, sizeof(buf), "%lld %d %d ", tag, offset, type);
+		fn_cache_add_mtag_data(buf, value);
+	}
+
+	tmp = find_mtag_value(tag, offset, type);
+	if (tmp) {
+		if (strcmp(tmp->value, value) == 0)
+			return;
+		free(tmp->value);
+		tmp->value = strdup(value);
+		tmp->rl_type = NULL;
+		tmp->rl = NULL;
+		return;
+	}
+
+	tmp = calloc(1, sizeof(*tmp));
+	if (!tmp)
+		sm_fatal("out of memory");
+	tmp->tag = tag;
+	tmp->offset = offset;
+	tmp->type = type;
+	tmp->value = strdup(value);
+
+	idx = mtag_value_hash(tag, offset, type);
+	tmp->next = mtag_values[idx];
+	mtag_values[idx] = tmp;
+	*value_tail = tmp;
+	value_tail = &tmp->list_next;
+}
+
+static const char *get_mtag_value(mtag_t tag, int offset, int type)
+{
+	struct mtag_value *tmp;
+	char buf[64];
+
+	tmp = find_mtag_value(tag, offset, type);
+	if (fn_cache_recording(mem_db)) {
+		snprintf(buf, sizeof(buf), "%lld %d %d", tag, offset, type);
+		fn_cache_add_mtag_dep(buf, tmp ? tmp->value : "");
+	}
+	return tmp ? tmp->value : NULL;
+}
+
+static struct range_list *select_orig(mtag_t tag, int offset, struct symbol *type)
+{
+	struct mtag_value *tmp;
+
+	if (!get_mtag_value(tag, offset, DATA_VALUE))
+		return NULL;
+
+	tmp = find_mtag_value(tag, offset, DATA_VALUE);
+	if (tmp->rl_type != type || !tmp->rl) {
+		str_to_rl(type, tmp->value, &tmp->rl);
+		tmp->rl = clone_rl_permanent(tmp->rl);
+		tmp->rl_type = type;
+	}
+	return tmp->rl;
+}
+
+/* used by the function cache to check that a value hasn't changed */
+const char *get_mtag_data_value(const char *key)
+{
+	mtag_t tag;
+	int offset, type;
+	const char *value;
+
+	if (sscanf(key, "%lld %d %d", &tag, &offset, &type) != 3)
+		return NULL;
+	value = get_mtag_value(tag, offset, type);
+	return value ? value : "";
+}
+
+/* the function cache saves the changes as "<tag> <offset> <type> <value>" lines */
+void replay_mtag_data(const char *lines)
+{
+	const char *p, *end;
+	char *value, *q;
+	mtag_t tag;
+	int offset, type;
+
+	for (p = lines; p && *p; p = end + 1) {
+		end = strchr(p, '\n');
+		if (!end)
+			end = p + strlen(p);
+		tag = strtoll(p, &q, 10);
+		offset = strtol(q, &q, 10);
+		type = strtol(q, &q, 10);
+		if (*q == ' ' && q < end) {
+			value = strndup(q + 1, end - q - 1);
+			set_mtag_value(tag, offset, type, value);
+			free(value);
+		}
+		if (!*end)
+			break;
+	}
 }
 
 static int is_kernel_param(const char *name)
@@ -122,12 +252,7 @@ static void insert_mtag_data(mtag_t tag, int offset, struct range_list *rl)
 	if (is_ignored_tag(tag))
 		return;
 
-	rl = clone_rl_permanent(rl);
-
-	mem_sql(NULL, NULL, "delete from mtag_data where tag = %lld and offset = %d and type = %d",
-		tag, offset, DATA_VALUE);
-	mem_sql(NULL, NULL, "insert into mtag_data values (%lld, %d, %d, '%lu');",
-		tag, offset, DATA_VALUE, (unsigned long)rl);
+	set_mtag_value(tag, offset, DATA_VALUE, show_rl(rl));
 }
 
 static bool invalid_type(struct symbol *type)
@@ -163,6 +288,8 @@ void update_mtag_data(struct expression *expr, struct smatch_state *state)
 
 	if (!expr)
 		return;
+	if (tiered_cheap_pass())
+		return;
 	if (is_ignored_macro(expr))
 		return;
 	if (is_head_next(expr))
@@ -184,7 +311,7 @@ void update_mtag_data(struct expression *expr, struct smatch_state *state)
 	if (parent_is_fresh_alloc(expr))
 		orig = NULL;
 	else
-		orig = select_orig(tag, offset);
+		orig = select_orig(tag, offset, rl_type(estate_rl(state)));
 	new = rl_union(orig, estate_rl(state));
 	insert_mtag_data(tag, offset, new);
 }
@@ -214,28 +341,16 @@ static void match_global_assign(struct expression *expr)
 	insert_mtag_data(tag, offset, rl);
 }
 
-static int save_mtag_data(void *_unused, int argc, char **argv, char **azColName)
+static void match_end_file(struct symbol_list *sym_list)
 {
-	struct range_list *rl;
+	struct mtag_value *tmp;
 
-	if (argc != 4) {
-		sm_msg("Error saving mtag data");
-		return 0;
+	for (tmp = value_list; tmp; tmp = tmp->list_next) {
+		if (tmp->type != DATA_VALUE)
+			continue;
+		sm_sql("insert or ignore into mtag_data values ('%lld', '%d', '%d', '%s');",
+		       tmp->tag, tmp->offset, tmp->type, tmp->value);
 	}
-	if (!option_info)
-		return 0;
-
-	rl = (struct range_list *)strtoul(argv[3], NULL, 10);
-	sm_msg("SQL: insert or ignore into mtag_data values ('%s', '%s', '%s', '%s');",
-	       argv[0], argv[1], argv[2], show_rl(rl));
-
-	return 0;
-}
-
-static void match_end_file(struct symbol_list *sym_list)
-{
-	mem_sql(&save_mtag_data, NULL, "select * from mtag_data where type = %d;",
-		DATA_VALUE);
 }
 
 struct db_info {
@@ -283,7 +398,7 @@ static int get_rl_from_mtag_offset(mtag_t tag, int offset, struct symbol *type,
 		}
 	}
 
-	mem_rl = select_orig(tag, offset);
+	mem_rl = select_orig(tag, offset, type);
 	if (is_whole_rl(mem_rl))
 		goto update_cache;
 
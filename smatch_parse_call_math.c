@@ -552,7 +552,6 @@ static int db_buf_size_callback(void *unused, int argc, char **argv, char **azCo
 static char *get_allocation_recipe_from_call(struct expression *expr)
 {
 	struct symbol *sym;
-	static char sql_filter[1024];
 	int i;
 
 	if (is_fake_call(expr))
@@ -574,18 +573,10 @@ static char *get_allocation_recipe_from_call(struct expression *expr)
 		}
 	}
 
-	if (sym->ctype.modifiers & MOD_STATIC) {
-		snprintf(sql_filter, 1024, "file = '%s' and function = '%s';",
-			 get_filename(), sym->ident->name);
-	} else {
-		snprintf(sql_filter, 1024, "function = '%s' and static = 0;",
-				sym->ident->name);
-	}
-
 	buf_size_recipe = NULL;
 	run_sql(db_buf_size_callback, NULL,
-		"select value from return_states where type=%d and %s",
-		BUF_SIZE, sql_filter);
+		"select value from return_states where type=%d and %s;",
+		BUF_SIZE, get_static_filter(sym));
 	if (!buf_size_recipe || strcmp(buf_size_recipe, "invalid") == 0)
 		return NULL;
 	/* Known sizes should be handled in smatch_buf_size.c */
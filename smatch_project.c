@@ -74,6 +74,10 @@ int is_silenced_function(void)
 
 	if (is_skipped_function())
 		return 1;
+	if (changed_lines_silenced())
+		return 1;
+	if (tiered_silenced())
+		return 1;
 
 	func = get_function();
 	if (!func)
@@ -2148,7 +2148,6 @@ void free_data_info_allocs(void)
 		blob = next;
 	}
 	clear_array_values_cache();
-	clear_type_value_cache();
 	clear_data_range_alloc();
 }
 
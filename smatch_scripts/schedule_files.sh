@@ -0,0 +1,149 @@
+#!/bin/bash
+
+# Runs smatch on a list of files with the slowest files first.
+#
+# Every run records how long each file took in a times file, one "ms file"
+# line per file.  The next run sorts the files longest first using those
+# times and feeds them to xargs -P so whichever worker finishes first picks
+# up the next file.  That way the big files don't get started at the end of
+# the run and stretch it out.
+#
+# The times are kept out of the DB so that building the DB twice gives the
+# same result.  FUNC_TIME in the DB is only in whole seconds.
+#
+# Files which aren't in the times file get the average cost.  It prints the
+# makespan predicted from the times for the original order and for the
+# sorted order and how long the run actually took.
+
+NR_CPU=$(cat /proc/cpuinfo | grep ^processor | wc -l)
+TIMES=smatch_file_times.txt
+SCRIPT_DIR=$(dirname $0)
+CMD=""
+
+function usage {
+    echo "Usage:  $0 [options] file.c..."
+    echo " available options:"
+    echo "	--jobs {N}     : number of workers, default: $NR_CPU"
+    echo "	--times {FILE} : the per file times, default: $TIMES"
+    echo "	--cmd {CMD}    : command to run on each file, default: smatch --file-output"
+    echo "	--dry-run      : print the order and the predicted makespan"
+    echo "	--help         : Show this usage"
+    echo
+    echo "For the kernel use --cmd \"$SCRIPT_DIR/kchecker --file-output\"."
+    exit 1
+}
+
+while true ; do
+    if [[ "$1" == "--jobs" ]] ; then
+	NR_CPU="$2"
+	shift 2
+    elif [[ "$1" == "--times" ]] ; then
+	TIMES="$2"
+	shift 2
+    elif [[ "$1" == "--cmd" ]] ; then
+	CMD="$2"
+	shift 2
+    elif [[ "$1" == "--dry-run" ]] ; then
+	DRY_RUN=1
+	shift
+    elif [[ "$1" == "--help" ]] ; then
+	usage
+    else
+	break
+    fi
+done
+
+if [[ "$1" == "" ]] ; then
+    usage
+fi
+
+if [[ "$CMD" == "" ]] ; then
+    if [ -e $SCRIPT_DIR/../smatch ] ; then
+	CMD="$SCRIPT_DIR/../smatch --file-output"
+    elif which smatch | grep smatch > /dev/null ; then
+	CMD="smatch --file-output"
+    else
+	echo "Smatch binary not found."
+	exit 1
+    fi
+fi
+
+TMP=$(mktemp -d)
+trap "rm -rf $TMP" EXIT
+
+if [ -e $TIMES ] ; then
+    cp $TIMES $TMP/costs
+else
+    echo "warning: $TIMES not found.  Using the original order."
+    touch $TMP/costs
+fi
+
+for file in "$@" ; do
+    echo "$file"
+done > $TMP/files
+
+# Print "cost file" in the original order.  Unknown files get the average.
+awk 'FILENAME == ARGV[1] { cost[substr($0, index($0, " ") + 1)] = $1
+			  total += $1; nr++; next }
+     { costs[FNR] = ($0 in cost) ? cost[$0] : -1
+       names[FNR] = $0 }
+     END {
+	avg = nr ? int(total / nr) : 1
+	for (i = 1; i <= FNR; i++)
+		print (costs[i] < 0 ? avg : costs[i]), names[i]
+     }' $TMP/costs $TMP/files > $TMP/unsorted
+
+sort -s -k1,1nr $TMP/unsorted > $TMP/sorted
+
+# The makespan if each file goes to whichever worker is free first.
+function makespan {
+    awk -v jobs=$NR_CPU '{
+	min = 1
+	for (i = 2; i <= jobs; i++)
+		if (load[i] < load[min])
+			min = i
+	load[min] += $1
+     }
+     END {
+	max = 0
+	for (i = 1; i <= jobs; i++)
+		if (load[i] > max)
+			max = load[i]
+	printf "%.1f", max / 1000
+     }' $1
+}
+
+if [[ "$DRY_RUN" == "1" ]] ; then
+    cat $TMP/sorted
+fi
+
+echo "predicted makespan: $(makespan $TMP/unsorted)s in the original order, $(makespan $TMP/sorted)s sorted ($NR_CPU jobs)"
+
+if [[ "$DRY_RUN" == "1" ]] ; then
+    exit 0
+fi
+
+# run one file and save how long it took
+function run_file {
+    local start stop
+
+    start=$(date +%s%N)
+    $CMD "$1"
+    stop=$(date +%s%N)
+    echo "$(( (stop - start) / 1000000 )) $1" >> $TMP/times
+}
+export -f run_file
+export CMD TMP
+
+start=$(date +%s%N)
+cut -d ' ' -f 2- $TMP/sorted | tr '\n' '\0' | \
+    xargs -0 -n 1 -P $NR_CPU bash -c 'run_file "$1"' run_file
+stop=$(date +%s%N)
+
+# the new times replace the old ones and the other files are kept
+touch $TMP/times
+awk 'FILENAME == ARGV[1] { new[substr($0, index($0, " ") + 1)]; print; next }
+     !(substr($0, index($0, " ") + 1) in new)' $TMP/times $TMP/costs > $TMP/merged
+cp $TMP/merged $TIMES
+
+echo "actual makespan: $(( (stop - start) / 1000000000 )).$(( (stop - start) / 100000000 % 10 ))s"
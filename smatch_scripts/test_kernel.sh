@@ -45,6 +45,10 @@ INFO=0
 if echo "$*" | grep -q info ; then
     INFO=1
 fi
+SHARDS=0
+if echo "$*" | grep -q db-shard ; then
+    SHARDS=1
+fi
 
 # receive parameters from environment, which override
 [ -z "${SMATCH_ENV_TARGET:-}" ] || TARGET="$SMATCH_ENV_TARGET"
@@ -72,11 +76,15 @@ make $KERNEL_ARCH $KERNEL_CROSS_COMPILE clean
 find -name \*.c.smatch -exec rm \{\} \;
 find -name \*.c.smatch.sql -exec rm \{\} \;
 find -name \*.c.smatch.caller_info -exec rm \{\} \;
+find -name \*.c.smatch.db -exec rm \{\} \;
 make $KERNEL_ARCH $KERNEL_CROSS_COMPILE -j${NR_CPU} $ENDIAN -k CHECK="$CMD -p=kernel --file-output --succeed $*" \
 	C=1 $BUILD_PARAM $TARGET 2>&1 | tee $LOG
 BUILD_STATUS=${PIPESTATUS[0]}
 find -name \*.c.smatch -exec cat \{\} \; -exec rm \{\} \; > $WLOG
-if [[ $INFO -eq 1 ]] ; then
+if [[ $INFO -eq 1 && $SHARDS -eq 1 ]] ; then
+    # create_db.sh merges these
+    find $(pwd) -name \*.c.smatch.db > $WLOG.shards
+elif [[ $INFO -eq 1 ]] ; then
     find -name \*.c.smatch.sql -exec cat \{\} \; -exec rm \{\} \; > $WLOG.sql
     find -name \*.c.smatch.caller_info -exec cat \{\} \; -exec rm \{\} \; > $WLOG.caller_info
 fi
@@ -25,6 +25,7 @@
 ALLOCATOR(smatch_state, "smatch state");
 ALLOCATOR(sm_state, "sm state");
 ALLOCATOR(named_stree, "named slist");
+ALLOCATOR(pending_stree, "pending goto strees");
 __DO_ALLOCATOR(char, 1, 4, "state names", sname);
 
 int sm_state_counter;
@@ -140,7 +141,7 @@ bool has_dynamic_states(unsigned short owner)
 	return dynamic_states[owner];
 }
 
-static int cmp_possible_sm(const struct sm_state *a, const struct sm_state *b, int preserve)
+static int cmp_possible_key(const struct sm_state *a, const struct sm_state *b, int preserve)
 {
 	int ret;
 
@@ -169,15 +170,12 @@ static int cmp_possible_sm(const struct sm_state *a, const struct sm_state *b, i
 
 		/*
 		 * We want to preserve leaf states.  They're use to split
-		 * returns in smatch_db.c.
+		 * returns in smatch_db.c.  The merged states go first and the
+		 * leaf states are sorted by name after them.
 		 *
 		 */
-		if (preserve) {
-			if (a->merged && !b->merged)
-				return -1;
-			if (!a->merged)
-				return 1;
-		}
+		if (preserve && a->merged != b->merged)
+			return a->merged ? -1 : 1;
 	}
 	if (!a->state->name || !b->state->name)
 		return 0;
@@ -185,6 +183,26 @@ static int cmp_possible_sm(const struct sm_state *a, const struct sm_state *b, i
 	return strcmp(a->state->name, b->state->name);
 }
 
+static int cmp_possible_sm(const struct sm_state *a, const struct sm_state *b, int preserve)
+{
+	int ret;
+
+	if (a == b)
+		return 0;
+
+	ret = cmp_possible_key(a, b, preserve);
+	if (ret)
+		return ret;
+
+	/*
+	 * Leaf states with the same name can come from different places
+	 * so we keep all of them in the order they were added.
+	 */
+	if (preserve && a->owner == SMATCH_EXTRA && !a->merged && !b->merged)
+		return -1;
+	return 0;
+}
+
 struct sm_state *alloc_sm_state(int owner, const char *name,
 				struct symbol *sym, struct smatch_state *state)
 {
@@ -247,11 +265,63 @@ void add_possible_sm(struct sm_state *to, struct sm_state *new)
 	add_ptr_list(&to->possible, new);
 }
 
+/*
+ * This is add_possible_sm() except that it starts looking at *pos instead of
+ * at the start of the array.  When we add the states from another sorted
+ * possible list the next insertion point is never before the last one.
+ */
+static void insert_possible(struct sm_state **possibles, int *nr, int *pos,
+			    struct sm_state *new)
+{
+	int cmp;
+	int i;
+
+	i = *pos;
+	while (i < *nr && cmp_possible_key(possibles[i], new, 1) < 0)
+		i++;
+	*pos = i;
+
+	for (; i < *nr; i++) {
+		cmp = cmp_possible_sm(possibles[i], new, 1);
+		if (cmp == 0)
+			return;
+		if (cmp > 0)
+			break;
+	}
+	memmove(&possibles[i + 1], &possibles[i], (*nr - i) * sizeof(*possibles));
+	possibles[i] = new;
+	(*nr)++;
+}
+
+/*
+ * Creating fake history in smatch_implied.c changes leaf states into merged
+ * states after they have been added to possible lists so we can't assume the
+ * lists are sorted.
+ */
+static bool possibles_sorted(struct sm_state *sm)
+{
+	struct sm_state *prev = NULL;
+	struct sm_state *tmp;
+
+	FOR_EACH_PTR(sm->possible, tmp) {
+		if (prev && cmp_possible_key(prev, tmp, 1) > 0)
+			return false;
+		prev = tmp;
+	} END_FOR_EACH_PTR(tmp);
+
+	return true;
+}
+
 static void copy_possibles(struct sm_state *to, struct sm_state *one, struct sm_state *two)
 {
+	struct sm_state *possibles[100];
 	struct sm_state *large = one;
 	struct sm_state *small = two;
 	struct sm_state *tmp;
+	int large_nr, small_nr;
+	int nr = 0;
+	int pos;
+	int i;
 
 	/*
 	 * We spend a lot of time copying the possible lists.  I've tried to
@@ -259,17 +329,50 @@ static void copy_possibles(struct sm_state *to, struct sm_state *one, struct sm_
 	 *
 	 */
 
-	if (ptr_list_size((struct ptr_list *)two->possible) >
-	    ptr_list_size((struct ptr_list *)one->possible)) {
+	large_nr = ptr_list_size((struct ptr_list *)one->possible);
+	small_nr = ptr_list_size((struct ptr_list *)two->possible);
+	if (small_nr > large_nr) {
 		large = two;
 		small = one;
+		i = large_nr;
+		large_nr = small_nr;
+		small_nr = i;
 	}
 
-	to->possible = clone_slist(large->possible);
-	add_possible_sm(to, to);
+	/*
+	 * Once there are 100 possible states add_possible_sm() stops
+	 * preserving the leaf states and the sort order changes so do it the
+	 * slow way if we could get there.
+	 */
+	if (large_nr + small_nr >= ARRAY_SIZE(possibles) ||
+	    !possibles_sorted(large) || !possibles_sorted(small)) {
+		to->possible = clone_slist(large->possible);
+		add_possible_sm(to, to);
+		FOR_EACH_PTR(small->possible, tmp) {
+			add_possible_sm(to, tmp);
+		} END_FOR_EACH_PTR(tmp);
+		return;
+	}
+
+	/*
+	 * Otherwise it's a single pass merge.  Normally the small list is
+	 * mostly the same states as the large list so there is not much to
+	 * insert.
+	 */
+	FOR_EACH_PTR(large->possible, tmp) {
+		possibles[nr++] = tmp;
+	} END_FOR_EACH_PTR(tmp);
+
+	pos = 0;
+	insert_possible(possibles, &nr, &pos, to);
+	pos = 0;
 	FOR_EACH_PTR(small->possible, tmp) {
-		add_possible_sm(to, tmp);
+		insert_possible(possibles, &nr, &pos, tmp);
 	} END_FOR_EACH_PTR(tmp);
+
+	to->possible = NULL;
+	for (i = 0; i < nr; i++)
+		add_ptr_list(&to->possible, possibles[i]);
 }
 
 char *alloc_sname(const char *str)
@@ -1060,23 +1163,6 @@ void or_stree_stack(struct stree_stack **pre_conds,
 	free_stree(&old);
 }
 
-/*
- * get_named_stree() is only used for gotos.
- */
-struct stree **get_named_stree(struct named_stree_stack *stack,
-			       const char *name,
-			       struct symbol *sym)
-{
-	struct named_stree *tmp;
-
-	FOR_EACH_PTR(stack, tmp) {
-		if (tmp->sym == sym &&
-		    strcmp(tmp->name, name) == 0)
-			return &tmp->stree;
-	} END_FOR_EACH_PTR(tmp);
-	return NULL;
-}
-
 /* FIXME:  These parameters are in a different order from expected */
 void overwrite_stree(struct stree *from, struct stree **to)
 {
@@ -5,10 +5,19 @@ extern int unfree_stree;
 DECLARE_PTR_LIST(state_list, struct sm_state);
 DECLARE_PTR_LIST(state_list_stack, struct state_list);
 
+struct pending_stree {
+	struct stree *stree;
+	int line;
+};
+DECLARE_ALLOCATOR(pending_stree);
+DECLARE_PTR_LIST(pending_stree_list, struct pending_stree);
+
 struct named_stree {
 	char *name;
 	struct symbol *sym;
 	struct stree *stree;
+	struct pending_stree_list *pending;
+	struct named_stree *next;
 };
 DECLARE_ALLOCATOR(named_stree);
 DECLARE_PTR_LIST(named_stree_stack, struct named_stree);
@@ -86,10 +95,6 @@ void or_stree_stack(struct stree_stack **pre_conds,
 		    struct stree *cur_stree,
 		    struct stree_stack **stack);
 
-struct stree **get_named_stree(struct named_stree_stack *stack,
-			       const char *name,
-			       struct symbol *sym);
-
 void overwrite_stree(struct stree *from, struct stree **to);
 
 /* add stuff smatch_returns.c here */
@@ -63,6 +63,7 @@ static struct stree_stack *default_stack;
 static struct stree_stack *continue_stack;
 
 static struct named_stree_stack *goto_stack;
+static struct named_stree *goto_hash[256];
 
 static struct ptr_list *backup;
 
@@ -730,6 +731,7 @@ void save_all_states(void)
 
 	__add_ptr_list(&backup, goto_stack);
 	goto_stack = NULL;
+	memset(goto_hash, 0, sizeof(goto_hash));
 }
 
 static void *pop_backup(void)
@@ -741,9 +743,16 @@ static void *pop_backup(void)
 	return ret;
 }
 
+static void add_goto_hash(struct named_stree *named_stree);
+
 void restore_all_states(void)
 {
+	struct named_stree *named_stree;
+
 	goto_stack = pop_backup();
+	FOR_EACH_PTR(goto_stack, named_stree) {
+		add_goto_hash(named_stree);
+	} END_FOR_EACH_PTR(named_stree);
 
 	continue_stack = pop_backup();
 	default_stack = pop_backup();
@@ -767,11 +776,17 @@ void restore_all_states(void)
 void free_goto_stack(void)
 {
 	struct named_stree *named_stree;
+	struct pending_stree *pending;
 
 	FOR_EACH_PTR(goto_stack, named_stree) {
+		FOR_EACH_PTR(named_stree->pending, pending) {
+			free_stree(&pending->stree);
+		} END_FOR_EACH_PTR(pending);
+		__free_ptr_list((struct ptr_list **)&named_stree->pending);
 		free_stree(&named_stree->stree);
 	} END_FOR_EACH_PTR(named_stree);
 	__free_ptr_list((struct ptr_list **)&goto_stack);
+	memset(goto_hash, 0, sizeof(goto_hash));
 }
 
 void clear_all_states(void)
@@ -1233,34 +1248,99 @@ static struct named_stree *alloc_named_stree(const char *name, struct symbol *sy
 	named_stree->name = (char *)name;
 	named_stree->stree = stree;
 	named_stree->sym = sym;
+	named_stree->pending = NULL;
+	named_stree->next = NULL;
 	return named_stree;
 }
 
-void __save_gotos(const char *name, struct symbol *sym)
+/*
+ * Labels are hashed on the symbol.  The loop labels from get_loop_name()
+ * don't have a symbol so those are hashed on the name.
+ */
+static unsigned int goto_hash_idx(const char *name, struct symbol *sym)
 {
-	struct stree **stree;
-	struct stree *clone;
+	unsigned long hash = (unsigned long)sym >> 4;
 
-	stree = get_named_stree(goto_stack, name, sym);
-	if (stree) {
-		merge_stree(stree, cur_stree);
-		return;
-	} else {
-		struct named_stree *named_stree;
+	if (!sym) {
+		while (*name)
+			hash = hash * 33 + *name++;
+	}
+	return hash % ARRAY_SIZE(goto_hash);
+}
 
-		clone = clone_stree(cur_stree);
-		named_stree = alloc_named_stree(name, sym, clone);
+static void add_goto_hash(struct named_stree *named_stree)
+{
+	unsigned int idx = goto_hash_idx(named_stree->name, named_stree->sym);
+
+	named_stree->next = goto_hash[idx];
+	goto_hash[idx] = named_stree;
+}
+
+static struct named_stree *get_goto(const char *name, struct symbol *sym)
+{
+	struct named_stree *tmp;
+
+	for (tmp = goto_hash[goto_hash_idx(name, sym)]; tmp; tmp = tmp->next) {
+		if (tmp->sym == sym && strcmp(tmp->name, name) == 0)
+			return tmp;
+	}
+	return NULL;
+}
+
+/*
+ * We don't merge the states at each goto.  The first goto's stree becomes the
+ * label's stree and the later gotos save a copy of theirs.  When we reach the
+ * label they are merged in the order the gotos were seen, each one with the
+ * line number of its goto so the merged sm_states get the same ->line.
+ *
+ * This is not exactly the same as merging at each goto.  merge_stree() creates
+ * the pools and gives them stree ids when it runs, so now that happens at the
+ * label, after any merges done between the gotos and the label.  The
+ * implications which are worked out from those pools can be more or less
+ * precise than before.  It changes a handful of return states in evaluate.c.
+ */
+static void merge_pending_gotos(struct named_stree *named_stree)
+{
+	struct pending_stree *pending;
+	int orig_line = __smatch_lineno;
+
+	FOR_EACH_PTR(named_stree->pending, pending) {
+		__smatch_lineno = pending->line;
+		merge_stree(&named_stree->stree, pending->stree);
+		free_stree(&pending->stree);
+	} END_FOR_EACH_PTR(pending);
+	__free_ptr_list((struct ptr_list **)&named_stree->pending);
+	__smatch_lineno = orig_line;
+}
+
+void __save_gotos(const char *name, struct symbol *sym)
+{
+	struct named_stree *named_stree;
+	struct pending_stree *pending;
+
+	named_stree = get_goto(name, sym);
+	if (!named_stree) {
+		named_stree = alloc_named_stree(name, sym, clone_stree(cur_stree));
 		add_ptr_list(&goto_stack, named_stree);
+		add_goto_hash(named_stree);
+		return;
 	}
+
+	pending = __alloc_pending_stree(0);
+	pending->stree = clone_stree(cur_stree);
+	pending->line = get_lineno();
+	add_ptr_list(&named_stree->pending, pending);
 }
 
 void __merge_gotos(const char *name, struct symbol *sym)
 {
-	struct stree **stree;
+	struct named_stree *named_stree;
 
-	stree = get_named_stree(goto_stack, name, sym);
-	if (stree)
-		merge_stree(&cur_stree, *stree);
+	named_stree = get_goto(name, sym);
+	if (!named_stree)
+		return;
+	merge_pending_gotos(named_stree);
+	merge_stree(&cur_stree, named_stree->stree);
 }
 
 void __discard_fake_states(struct expression *call)
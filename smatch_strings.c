@@ -18,6 +18,7 @@
 #include "smatch.h"
 #include "smatch_slist.h"
 #include "smatch_extra.h"
+#include "smatch_literals.h"
 
 static int my_id;
 
@@ -139,7 +140,7 @@ static void match_string(struct expression *expr)
 		return;
 
 	cache_sql(NULL, NULL, "insert or ignore into mtag_data values (%lld, %d, %d, '%q');",
-		  tag, 0, STRING_VALUE, escape_newlines(expr->string->data));
+		  tag, 0, STRING_VALUE, get_escaped_literal(expr->string));
 }
 
 void register_strings(int id)
@@ -21,6 +21,7 @@
 #include "smatch.h"
 #include "smatch_slist.h"
 #include "smatch_extra.h"
+#include "smatch_literals.h"
 
 #define UNKNOWN_SIZE (-1)
 
@@ -236,11 +237,13 @@ static void match_strcpy(const char *fn, struct expression *expr, void *unused)
 
 static int get_strlen_from_string(struct expression *expr, struct range_list **rl)
 {
+	struct literal_info *info;
 	sval_t sval;
-	int len;
 
-	len = expr->string->length;
-	sval = sval_type_val(&int_ctype, len - 1);
+	info = get_literal_info(expr->string);
+	if (!info)
+		return 0;
+	sval = sval_type_val(&int_ctype, info->strlen);
 	*rl = alloc_rl(sval, sval);
 	return 1;
 }
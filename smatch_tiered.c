@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * With --tiered each function is parsed with a cheap pass first.  The cheap
+ * pass turns off implications, the comparison tracking and the buffer size
+ * comparisons, and it doesn't print anything.  If a check tries to print a
+ * warning then the function is a candidate and it is parsed again with
+ * everything turned on.  Most functions don't warn so they only pay for the
+ * cheap pass.
+ *
+ * Less information mostly means more warnings, not fewer, so the candidates
+ * should cover the real warnings.  Inlining is the exception.  Without it a
+ * static helper which frees its argument looks like it does nothing, so
+ * inlining stays on.  The "p vs p orig" comparisons which say whether a
+ * parameter was changed stay on for the same reason.  That's still not
+ * guaranteed so this is for quick runs and not for building the DB.
+ *
+ * The cheap pass doesn't write the mtag data or the cache_db because the
+ * later functions would read its results back.  For the same reason it
+ * doesn't use the --fn-cache inline results, see load_inline_results().
+ *
+ * The escalated functions are parsed both ways so they tell us how much
+ * slower the full pass is.  That ratio is used to estimate the time saved on
+ * the functions which only got the cheap pass.
+ */
+
+#include "smatch.h"
+
+int option_tiered;
+
+static bool cheap_pass;
+static int candidates;
+static struct timeval pass_start;
+
+static int nr_functions;
+static int nr_escalated;
+static unsigned long long cheap_ms;
+static unsigned long long escalated_cheap_ms;
+static unsigned long long full_ms;
+
+void check_tiered_options(void)
+{
+	if (option_tiered && option_info)
+		sm_fatal("--tiered doesn't work with --info");
+}
+
+bool tiered_cheap_pass(void)
+{
+	return cheap_pass;
+}
+
+bool tiered_silenced(void)
+{
+	if (!cheap_pass)
+		return false;
+	candidates++;
+	return true;
+}
+
+void tiered_start_cheap_pass(void)
+{
+	cheap_pass = true;
+	candidates = 0;
+	gettimeofday(&pass_start, NULL);
+}
+
+/*
+ * Returns true if the function needs a full pass.
+ */
+bool tiered_end_cheap_pass(void)
+{
+	int ms;
+
+	ms = ms_since(&pass_start);
+	cheap_pass = false;
+
+	nr_functions++;
+	cheap_ms += ms;
+	if (!candidates)
+		return false;
+
+	nr_escalated++;
+	escalated_cheap_ms += ms;
+	gettimeofday(&pass_start, NULL);
+	return true;
+}
+
+void tiered_end_full_pass(void)
+{
+	if (!option_tiered)
+		return;
+	full_ms += ms_since(&pass_start);
+}
+
+void print_tiered_stats(void)
+{
+	double ratio;
+	long long saved;
+
+	if (!option_tiered)
+		return;
+
+	sm_printf("tiered: %d functions, %d escalated, cheap pass %llums, full pass %llums\n",
+		  nr_functions, nr_escalated, cheap_ms, full_ms);
+
+	if (!escalated_cheap_ms) {
+		sm_printf("tiered: saved unknown (no escalated functions to compare)\n");
+		return;
+	}
+	ratio = (double)full_ms / escalated_cheap_ms;
+	saved = (cheap_ms - escalated_cheap_ms) * (ratio - 1) - escalated_cheap_ms;
+	sm_printf("tiered: saved about %lldms (the full pass is %.1fx slower)\n",
+		  saved, ratio);
+}
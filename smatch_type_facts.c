@@ -0,0 +1,309 @@
+/*
+ * Copyright (C) 2024 Oracle.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see http://www.gnu.org/copyleft/gpl.txt
+ */
+
+/*
+ * The type_value, type_size and type_info tables are keyed by struct member
+ * names like "(struct foo)->bar".  The same members are looked up over and
+ * over, so the facts are kept here in a hash table keyed by the member name.
+ *
+ * The first time we see a member of a struct, we load the rows for every
+ * member of that struct from all three tables.  The keys all start with
+ * "(struct foo)->" so that's a range query on the type index.  After that
+ * every member of the struct is answered from memory, including the members
+ * which aren't in the DB.
+ *
+ * The DB doesn't change while we're running so nothing is ever freed.  The
+ * function_type_size lookups for static variables are per file so they are
+ * keyed on the file id as well.
+ */
+
+#include "smatch.h"
+#include "smatch_extra.h"
+
+#define TYPE_FACT_HASH_SIZE 4096
+
+struct type_fact {
+	char *key;
+	unsigned int has_value:1;
+	unsigned int has_size:1;
+	char *value;
+	struct symbol *value_rl_type;
+	struct range_list *value_rl;
+	struct range_list *size_rl;
+	char *units;
+	struct type_fact *next;
+};
+
+struct file_size {
+	long long file;
+	char *name;
+	struct range_list *size_rl;
+	struct file_size *next;
+};
+
+static struct type_fact *facts[TYPE_FACT_HASH_SIZE];
+static struct type_fact *loaded_structs[TYPE_FACT_HASH_SIZE];
+static struct file_size *file_sizes[TYPE_FACT_HASH_SIZE];
+
+static unsigned int hash_key(const char *str, int len)
+{
+	unsigned long hash = 5381;
+	int i;
+
+	for (i = 0; i < len; i++)
+		hash = ((hash << 5) + hash) + (unsigned char)str[i];
+
+	return hash % TYPE_FACT_HASH_SIZE;
+}
+
+static struct type_fact *find_fact(struct type_fact **table, const char *key, int len)
+{
+	struct type_fact *tmp;
+
+	for (tmp = table[hash_key(key, len)]; tmp; tmp = tmp->next) {
+		if (strncmp(tmp->key, key, len) == 0 && tmp->key[len] == '\0')
+			return tmp;
+	}
+	return NULL;
+}
+
+static struct type_fact *add_fact(struct type_fact **table, const char *key, int len)
+{
+	struct type_fact *tmp;
+	unsigned int idx;
+
+	tmp = calloc(1, sizeof(*tmp));
+	if (!tmp)
+		sm_fatal("out of memory");
+	tmp->key = strndup(key, len);
+	idx = hash_key(key, len);
+	tmp->next = table[idx];
+	table[idx] = tmp;
+	return tmp;
+}
+
+static struct type_fact *get_fact(const char *key)
+{
+	struct type_fact *tmp;
+	int len = strlen(key);
+
+	tmp = find_fact(facts, key, len);
+	if (!tmp)
+		tmp = add_fact(facts, key, len);
+	return tmp;
+}
+
+static int load_type_value(void *unused, int argc, char **argv, char **azColName)
+{
+	struct type_fact *fact;
+
+	if (argc != 2 || !argv[0] || !argv[1])
+		return 0;
+
+	/* get_db_type_rl() always used the last row */
+	fact = get_fact(argv[0]);
+	free(fact->value);
+	fact->value = strdup(argv[1]);
+	fact->has_value = 1;
+	return 0;
+}
+
+static int load_type_size(void *unused, int argc, char **argv, char **azColName)
+{
+	struct type_fact *fact;
+	struct range_list *rl = NULL;
+
+	if (argc != 2 || !argv[0] || !argv[1])
+		return 0;
+
+	fact = get_fact(argv[0]);
+	str_to_rl(&int_ctype, argv[1], &rl);
+	if (fact->has_size)
+		rl = rl_union(fact->size_rl, rl);
+	fact->size_rl = clone_rl_permanent(rl);
+	fact->has_size = 1;
+	return 0;
+}
+
+static int load_type_units(void *unused, int argc, char **argv, char **azColName)
+{
+	struct type_fact *fact;
+
+	if (argc != 2 || !argv[0] || !argv[1])
+		return 0;
+
+	fact = get_fact(argv[0]);
+	if (fact->units) {
+		if (strcmp(fact->units, argv[1]) == 0)
+			return 0;
+		free(fact->units);
+		fact->units = strdup("unknown");
+		return 0;
+	}
+	fact->units = strdup(argv[1]);
+	return 0;
+}
+
+static void load_struct(const char *member)
+{
+	const char *p;
+	char start[256], end[256];
+	int len;
+
+	p = strstr(member, "->");
+	if (!p)
+		return;
+	len = p + 2 - member;
+	if (len + 1 > sizeof(start))
+		return;
+
+	if (find_fact(loaded_structs, member, len))
+		return;
+	add_fact(loaded_structs, member, len);
+
+	if (option_no_db)
+		return;
+
+	/* everything from "(struct foo)->" up to but not including "(struct foo)-?" */
+	snprintf(start, sizeof(start), "%.*s", len, member);
+	snprintf(end, sizeof(end), "%.*s?", len - 1, member);
+
+	run_sql(load_type_value, NULL,
+		"select type, value from type_value where type >= '%q' and type < '%q';",
+		start, end);
+	run_sql(load_type_size, NULL,
+		"select type, size from type_size where type >= '%q' and type < '%q';",
+		start, end);
+	run_sql(load_type_units, NULL,
+		"select key, value from type_info where type = %d and key >= '%q' and key < '%q';",
+		UNITS, start, end);
+}
+
+static struct type_fact *lookup_fact(const char *member)
+{
+	load_struct(member);
+	return find_fact(facts, member, strlen(member));
+}
+
+/*
+ * The function cache needs to know which rows a function depended on.  We
+ * record the query that the caller used to run instead of the range query
+ * which actually loaded the row.
+ */
+static void add_fn_cache_dep(const char *fmt, ...)
+{
+	char sql[1024];
+	va_list args;
+
+	if (!fn_cache_recording(smatch_db))
+		return;
+
+	va_start(args, fmt);
+	sqlite3_vsnprintf(sizeof(sql), sql, fmt, args);
+	va_end(args);
+	fn_cache_add_dep(smatch_db, sql);
+}
+
+struct range_list *get_member_type_value(const char *member, struct symbol *type)
+{
+	struct type_fact *fact;
+
+	add_fn_cache_dep("select value from type_value where type = '%s';", member);
+
+	fact = lookup_fact(member);
+	if (!fact || !fact->has_value)
+		return NULL;
+
+	if (fact->value_rl_type != type || !fact->value_rl) {
+		struct range_list *rl = NULL;
+
+		str_to_rl(type, fact->value, &rl);
+		fact->value_rl = clone_rl_permanent(rl);
+		fact->value_rl_type = type;
+	}
+	return fact->value_rl;
+}
+
+struct range_list *get_member_type_size(const char *member)
+{
+	struct type_fact *fact;
+
+	add_fn_cache_dep("select size from type_size where type = '%s';", member);
+
+	fact = lookup_fact(member);
+	if (!fact || !fact->has_size)
+		return NULL;
+	return fact->size_rl;
+}
+
+const char *get_member_type_units(const char *member)
+{
+	struct type_fact *fact;
+
+	add_fn_cache_dep("select value from type_info where type = %d and key = '%s';",
+			 UNITS, member);
+
+	fact = lookup_fact(member);
+	if (!fact)
+		return NULL;
+	return fact->units;
+}
+
+static struct range_list *db_size_rl;
+static int load_file_size(void *unused, int argc, char **argv, char **azColName)
+{
+	struct range_list *tmp = NULL;
+
+	if (argc != 1 || !argv[0])
+		return 0;
+
+	str_to_rl(&int_ctype, argv[0], &tmp);
+	db_size_rl = db_size_rl ? rl_union(db_size_rl, tmp) : tmp;
+	return 0;
+}
+
+struct range_list *get_file_type_size(const char *name)
+{
+	struct file_size *tmp;
+	unsigned int idx;
+	long long file = get_file_id();
+
+	idx = hash_key(name, strlen(name));
+	for (tmp = file_sizes[idx]; tmp; tmp = tmp->next) {
+		if (tmp->file == file && strcmp(tmp->name, name) == 0) {
+			add_fn_cache_dep("select size from function_type_size where type = '%s' and file = %lld;",
+					 name, file);
+			return tmp->size_rl;
+		}
+	}
+
+	db_size_rl = NULL;
+	run_sql(load_file_size, NULL,
+		"select size from function_type_size where type = '%s' and file = %lld;",
+		name, file);
+
+	tmp = calloc(1, sizeof(*tmp));
+	if (!tmp)
+		sm_fatal("out of memory");
+	tmp->file = file;
+	tmp->name = strdup(name);
+	tmp->size_rl = clone_rl_permanent(db_size_rl);
+	tmp->next = file_sizes[idx];
+	file_sizes[idx] = tmp;
+
+	return tmp->size_rl;
+}
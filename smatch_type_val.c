@@ -53,50 +53,10 @@ void enable_type_val_lookups(void)
 	no_type_vals--;
 }
 
-static int get_vals(void *_db_vals, int argc, char **argv, char **azColName)
-{
-	char **db_vals = _db_vals;
-
-	*db_vals = alloc_string(argv[0]);
-	return 0;
-}
-
-struct expr_rl {
-	struct expression *expr;
-	struct range_list *rl;
-};
-static struct expr_rl cached_results[24];
-static int res_idx;
-
-static int get_cached(struct expression *expr, struct range_list **rl, int *ret)
-{
-	int i;
-
-	*ret = 0;
-
-	for (i = 0; i < ARRAY_SIZE(cached_results); i++) {
-		if (expr == cached_results[i].expr) {
-			if (cached_results[i].rl) {
-				*rl = clone_rl(cached_results[i].rl);
-				*ret = 1;
-			}
-			return 1;
-		}
-	}
-
-	return 0;
-}
-
 int get_db_type_rl(struct expression *expr, struct range_list **rl)
 {
-	char *db_vals = NULL;
-	char *member;
 	struct range_list *tmp;
-	struct symbol *type;
-	int ret;
-
-	if (get_cached(expr, rl, &ret))
-		return ret;
+	char *member;
 
 	if (no_type_vals)
 		return 0;
@@ -105,24 +65,12 @@ int get_db_type_rl(struct expression *expr, struct range_list **rl)
 	if (!member)
 		return 0;
 
-	res_idx = (res_idx + 1) % ARRAY_SIZE(cached_results);
-	cached_results[res_idx].expr = expr;
-	cached_results[res_idx].rl = NULL;
-
-	run_sql(get_vals, &db_vals,
-		"select value from type_value where type = '%s';", member);
+	tmp = get_member_type_value(member, get_type(expr));
 	free_string(member);
-	if (!db_vals)
-		return 0;
-	type = get_type(expr);
-	str_to_rl(type, db_vals, &tmp);
-	free_string(db_vals);
-	if (is_whole_rl(tmp))
+	if (!tmp || is_whole_rl(tmp))
 		return 0;
 
-	*rl = tmp;
-	cached_results[res_idx].rl = clone_rl(tmp);
-
+	*rl = clone_rl(tmp);
 	return 1;
 }
 
@@ -644,11 +592,6 @@ static void match_end_func_info(struct symbol *sym)
 	} END_FOR_EACH_SM(sm);
 }
 
-void clear_type_value_cache(void)
-{
-	memset(cached_results, 0, sizeof(cached_results));
-}
-
 static void match_after_func(struct symbol *sym)
 {
 	free_stree(&fn_type_val);
@@ -250,6 +250,7 @@ static struct smatch_state *get_units_from_type(struct expression *expr)
 {
 	char *member;
 	char *units = NULL;
+	const char *db_units_str;
 	struct smatch_state *ret = NULL;
 
 	member = get_member_name(expr);
@@ -259,8 +260,9 @@ static struct smatch_state *get_units_from_type(struct expression *expr)
 		return &page;
 	cache_sql(&db_units, &units, "select value from type_info where type = %d and key = '%s';",
 		  UNITS, member);
-	run_sql(&db_units, &units, "select value from type_info where type = %d and key = '%s';",
-		UNITS, member);
+	db_units_str = get_member_type_units(member);
+	if (db_units_str)
+		db_units(&units, 1, (char **)&db_units_str, NULL);
 	free_string(member);
 	if (!units)
 		return NULL;
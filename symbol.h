@@ -145,7 +145,7 @@ struct symbol_op {
 struct symbol {
 	enum type type:8;
 	enum namespace namespace:9;
-	unsigned char used:1, attr:2, enum_member:1, bound:1, parsed:1;
+	unsigned char used:1, attr:2, enum_member:1, bound:1, parsed:1, inline_added:1;
 	struct position pos;		/* Where this symbol was declared */
 	struct position endpos;		/* Where this symbol ends*/
 	struct ident *ident;		/* What identifier this symbol is associated with */
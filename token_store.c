@@ -27,125 +27,95 @@
 #include <string.h>
 #include "lib.h"
 #include "parse.h"
-#include "allocate.h"
 
-struct line {
-	struct position pos;
-	struct line *prev;
-	struct token *token;
-	struct line *next;
+/*
+ * The tokens are copied into one array per call to store_all_tokens() and
+ * each stream has a table indexed by line number which points to the first
+ * token on that line.  The tokens on a line are linked through ->next in
+ * the order they appear.
+ */
+struct line_table {
+	struct token **lines;
+	unsigned int nr;
 };
 
-__ALLOCATOR(struct token, "token store", perm_token);
-ALLOCATOR(line, "line of tokens");
+static struct line_table *tables;
+static int nr_tables;
 
-static struct token *copy_token(struct token *token)
+static struct line_table *get_line_table(struct position pos)
 {
-	struct token *new;
-
-	new = __alloc_perm_token(0);
-	memcpy(new, token, sizeof(*token));
-	new->next = NULL;
-	return new;
+	int nr = nr_tables;
+
+	if (pos.stream >= nr_tables) {
+		nr_tables = pos.stream + 1;
+		tables = realloc(tables, nr_tables * sizeof(*tables));
+		if (!tables)
+			die("out of memory storing tokens");
+		memset(tables + nr, 0, (nr_tables - nr) * sizeof(*tables));
+	}
+	return &tables[pos.stream];
 }
 
-static struct line *cursor;
-
-static void find_line(struct position pos)
+static struct token **get_line(struct position pos)
 {
-	if (!cursor)
-		return;
-	if (pos.line == cursor->pos.line)
-		return;
-	if (pos.line < cursor->pos.line) {
-		if (!cursor->prev)
-			return;
-		cursor = cursor->prev;
-		find_line(pos);
-		return;
+	struct line_table *table = get_line_table(pos);
+	unsigned int nr = table->nr;
+
+	if (pos.line >= table->nr) {
+		table->nr = nr ? nr : 256;
+		while (pos.line >= table->nr)
+			table->nr *= 2;
+		table->lines = realloc(table->lines, table->nr * sizeof(*table->lines));
+		if (!table->lines)
+			die("out of memory storing tokens");
+		memset(table->lines + nr, 0, (table->nr - nr) * sizeof(*table->lines));
 	}
-	if (!cursor->next)
-		return;
-	if (pos.line < cursor->next->pos.line)
-		return;
-	cursor = cursor->next;
-	find_line(pos);
+	return &table->lines[pos.line];
 }
 
-static void insert_into_line(struct token **current, struct token *new)
+static void store_token(struct token **line, struct token *new)
 {
-	if (!*current) {
-		*current = new;
-		return;
-	}
-
-	if (new->pos.pos < (*current)->pos.pos) {
-		new->next = *current;
-		*current = new;
-		return;
-	}
-
-	if (new->pos.pos == (*current)->pos.pos)
+	/* the tokens are almost always in order so this is short */
+	while (*line && (*line)->pos.pos < new->pos.pos)
+		line = &(*line)->next;
+	if (*line && (*line)->pos.pos == new->pos.pos)
 		return;
-
-	insert_into_line(&(*current)->next, new);
+	new->next = *line;
+	*line = new;
 }
 
-static void store_token(struct token *token)
+void store_all_tokens(struct token *token)
 {
-	token = copy_token(token);
-
-	find_line(token->pos);
+	struct token *tmp, *arena;
+	int nr = 0;
 
-	if (!cursor) {
-		cursor = __alloc_line(0);
-		cursor->pos = token->pos;
-		cursor->token = token;
+	for (tmp = token; token_type(tmp) != TOKEN_STREAMEND; tmp = tmp->next)
+		nr++;
+	if (!nr)
 		return;
-	}
 
-	if (token->pos.line < cursor->pos.line) {
-		cursor->prev = __alloc_line(0);
-		cursor->prev->next = cursor;
-		cursor = cursor->prev;
-		cursor->pos = token->pos;
-		cursor->token = token;
-		return;
-	}
+	arena = malloc(nr * sizeof(*arena));
+	if (!arena)
+		die("out of memory storing tokens");
 
-	if (token->pos.line == cursor->pos.line) {
-		insert_into_line(&cursor->token, token);
-		return;
-	}
-
-	cursor->next = __alloc_line(0);
-	cursor->next->prev = cursor;
-	cursor = cursor->next;
-	cursor->pos = token->pos;
-	cursor->token = token;
-}
-
-void store_all_tokens(struct token *token)
-{
-	while (token_type(token) != TOKEN_STREAMEND) {
-		store_token(token);
-		token = token->next;
+	for (tmp = arena; token_type(token) != TOKEN_STREAMEND; token = token->next) {
+		*tmp = *token;
+		tmp->next = NULL;
+		store_token(get_line(tmp->pos), tmp);
+		tmp++;
 	}
 }
 
 struct token *first_token_from_line(struct position pos)
 {
-	find_line(pos);
-
-	if (!cursor)
-		return NULL;
+	struct line_table *table;
 
-	if (cursor->pos.stream != pos.stream)
+	if (pos.stream >= nr_tables)
 		return NULL;
-	if (cursor->pos.line != pos.line)
+	table = &tables[pos.stream];
+	if (pos.line >= table->nr)
 		return NULL;
-
-	return cursor->token;
+	return table->lines[pos.line];
 }
 
 struct token *pos_get_token(struct position pos)
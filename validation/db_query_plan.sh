@@ -0,0 +1,58 @@
+#!/bin/bash
+
+# Prints the index SQLite uses for the queries which smatch_db.c builds
+# with get_static_filter().  See sm_db_query_plan.c.
+
+tmp_dir=$(mktemp -d) || exit 1
+db=$tmp_dir/smatch_db.sqlite
+data_dir=$(cd ../smatch_data/db && pwd)
+
+for i in $data_dir/*.schema ; do
+	sqlite3 $db < $i > /dev/null
+done
+$data_dir/build_early_index.sh $db > /dev/null
+$data_dir/build_late_index.sh $db > /dev/null
+
+plan()
+{
+	echo "$1"
+	echo "explain query plan $2" | sqlite3 $db | \
+		sed -n -e 's/.*USING \(COVERING \)\?INDEX \([^ ]*\) (\(.*\))$/	\2 (\3)/p' \
+		       -e 's/.*SCAN \(TABLE \)\?\([^ ]*\)$/	scan \2/p' \
+		       -e 's/.*TEMP B-TREE.*/	sort/p'
+}
+
+show_plans()
+{
+	local key=$1
+	local kind filter
+
+	for kind in static global ; do
+		if [ "$kind" = "static" ] ; then
+			filter="$key and static = 1 and file = 0x1234"
+		else
+			filter="$key and static = 0"
+		fi
+
+		plan "$kind return_states:" \
+			"select * from return_states where $filter order by file, return_id, type;"
+		plan "$kind return_summary:" \
+			"select rows, summary from return_summary where $filter order by file;"
+		plan "$kind caller_info:" \
+			"select * from caller_info where $filter order by call_id;"
+		plan "$kind common_caller_info:" \
+			"select * from common_caller_info where $filter order by call_id;"
+		plan "$kind call_implies:" \
+			"select * from call_implies where $filter;"
+		plan "$kind return_implies:" \
+			"select value from return_implies where $filter and type = 1047;"
+	done
+}
+
+show_plans "function = 'frob'"
+
+# the same thing after add_function_ids.sh
+$data_dir/add_function_ids.sh $db
+show_plans "function_id = 0x1234"
+
+rm -rf $tmp_dir
@@ -0,0 +1,12 @@
+#!/bin/bash
+
+# Runs smatch twice with a new --fn-cache, first with an empty cache and
+# then with the cache from the first run.  The output of each run starts
+# with "cold: " or "warm: ".
+tmp_dir=$(mktemp -d) || exit 1
+
+for run in cold warm ; do
+	../smatch --fn-cache=$tmp_dir/fn_cache $* 2>&1 | sed -e "s/^/$run: /"
+done
+
+rm -rf $tmp_dir
@@ -0,0 +1,19 @@
+#!/bin/bash
+
+# Runs smatch --info without --fn-cache and then twice with it, once with
+# an empty cache and once with the cache from the first run.  The output
+# should be the same each time.  The mtag_data and mtag_map rows are left
+# out because the tags of the __fake_return_%p variables change on every
+# run.
+tmp_dir=$(mktemp -d) || exit 1
+
+../smatch --info $* 2>&1 | grep -v 'into mtag_' > $tmp_dir/uncached
+for run in cold warm ; do
+	../smatch --info --fn-cache=$tmp_dir/fn_cache $* 2>&1 | \
+		grep -v 'into mtag_' > $tmp_dir/$run
+	if diff $tmp_dir/uncached $tmp_dir/$run ; then
+		echo "$run cache: same as uncached"
+	fi
+done
+
+rm -rf $tmp_dir
@@ -0,0 +1,34 @@
+#include "check_debug.h"
+
+int global;
+
+int one(int *p)
+{
+	if (!p)
+		return *p;
+	return 0;
+}
+
+int two(int *p)
+{
+	if (!p)
+		return *p;
+	return global;
+}
+
+int three(int *p)
+{
+	if (!p)
+		return *p;
+	return 0;
+}
+
+/*
+ * check-name: smatch --changed-lines
+ * check-command: smatch --changed-lines=3,21-22 -I.. sm_changed_lines.c
+ *
+ * check-output-start
+sm_changed_lines.c:15 two() error: we previously assumed 'p' could be null (see line 14)
+sm_changed_lines.c:22 three() error: we previously assumed 'p' could be null (see line 21)
+ * check-output-end
+ */
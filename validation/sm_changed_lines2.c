@@ -0,0 +1,29 @@
+#include "check_debug.h"
+
+static int limits[] = {
+	10,
+	20,
+};
+
+int frob(int *p)
+{
+	if (!p)
+		return *p;
+	return limits[1];
+}
+
+int other(int *p)
+{
+	if (!p)
+		return *p;
+	return 0;
+}
+
+/*
+ * check-name: smatch --changed-lines in a global initializer
+ * check-command: smatch --changed-lines=5 -I.. sm_changed_lines2.c
+ *
+ * check-output-start
+sm_changed_lines2.c:11 frob() error: we previously assumed 'p' could be null (see line 10)
+ * check-output-end
+ */
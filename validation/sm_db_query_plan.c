@@ -0,0 +1,66 @@
+/*
+ * Static functions are looked up with "function = 'x' and static = 1 and
+ * file = y" and the rest with "function = 'x' and static = 0".  Both should
+ * be a single index seek on all those columns.  The same goes for
+ * "function_id = x" after add_function_ids.sh.
+ */
+
+/*
+ * check-name: smatch DB query plans
+ * check-command: validation/db_query_plan.sh
+ *
+ * check-output-start
+static return_states:
+	return_states_fn_idx (function=? AND static=? AND file=?)
+static return_summary:
+	return_summary_fn_idx (function=? AND static=? AND file=?)
+static caller_info:
+	caller_fn_idx (function=? AND static=? AND file=?)
+static common_caller_info:
+	common_fn_idx (function=? AND static=? AND file=?)
+static call_implies:
+	sqlite_autoindex_call_implies_1 (function=? AND static=? AND file=?)
+static return_implies:
+	sqlite_autoindex_return_implies_1 (function=? AND static=? AND file=? AND type=?)
+global return_states:
+	return_states_fn_idx (function=? AND static=?)
+global return_summary:
+	return_summary_fn_idx (function=? AND static=?)
+global caller_info:
+	caller_fn_idx (function=? AND static=?)
+	sort
+global common_caller_info:
+	common_fn_idx (function=? AND static=?)
+	sort
+global call_implies:
+	sqlite_autoindex_call_implies_1 (function=? AND static=?)
+global return_implies:
+	sqlite_autoindex_return_implies_1 (function=? AND static=?)
+static return_states:
+	return_states_fid_idx (function_id=? AND static=? AND file=?)
+static return_summary:
+	return_summary_fid_idx (function_id=? AND static=? AND file=?)
+static caller_info:
+	caller_info_fid_idx (function_id=? AND static=? AND file=?)
+static common_caller_info:
+	common_caller_info_fid_idx (function_id=? AND static=? AND file=?)
+static call_implies:
+	call_implies_fid_idx (function_id=? AND static=? AND file=?)
+static return_implies:
+	return_implies_fid_idx (function_id=? AND static=? AND file=? AND type=?)
+global return_states:
+	return_states_fid_idx (function_id=? AND static=?)
+global return_summary:
+	return_summary_fid_idx (function_id=? AND static=?)
+global caller_info:
+	caller_info_fid_idx (function_id=? AND static=?)
+	sort
+global common_caller_info:
+	common_caller_info_fid_idx (function_id=? AND static=?)
+	sort
+global call_implies:
+	call_implies_fid_idx (function_id=? AND static=?)
+global return_implies:
+	return_implies_fid_idx (function_id=? AND static=?)
+ * check-output-end
+ */
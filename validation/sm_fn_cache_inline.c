@@ -0,0 +1,33 @@
+static int frob(int x)
+{
+	if (x)
+		return 1;
+	return 0;
+}
+
+int f1(int a)
+{
+	int ret = frob(a);
+
+	if (ret)
+		return -1;
+	return 0;
+}
+
+int f2(int a)
+{
+	int ret = frob(a);
+
+	if (ret)
+		return -1;
+	return 0;
+}
+/*
+ * check-name: smatch: replayed inlines give the same --info as parsing them
+ * check-command: validation/fn_cache_test.sh sm_fn_cache_inline.c
+ *
+ * check-output-start
+cold cache: same as uncached
+warm cache: same as uncached
+ * check-output-end
+ */
@@ -0,0 +1,31 @@
+#include "check_debug.h"
+
+static int frob(int *p)
+{
+	return *p + 1;
+}
+
+int frob_slow(int *p)
+{
+	return *p + 1;
+}
+
+void test(void)
+{
+	int val = 7;
+	int x, y;
+
+	x = frob(&val);
+	y = frob_slow(&val);
+	__smatch_implied(x);
+	__smatch_implied(y);
+}
+/*
+ * check-name: smatch: don't inline functions which took two seconds
+ * check-command: validation/smatch_sql_test.sh "insert into return_implies values(0, 'frob_slow', 0, 0, 1047, 0, '', '2');" -I.. sm_inline_func_time.c
+ *
+ * check-output-start
+sm_inline_func_time.c:20 test() implied: x = '8'
+sm_inline_func_time.c:21 test() implied: y = 's32min-s32max'
+ * check-output-end
+ */
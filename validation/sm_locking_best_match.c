@@ -0,0 +1,37 @@
+#include "../check_debug.h"
+
+struct foo {
+	int lock;
+	int tx_lock;
+};
+
+void spin_lock(int *lock);
+void spin_unlock(int *lock);
+void drop_tx(void);
+void drop_lock(void);
+
+void test(struct foo *a, struct foo *b)
+{
+	spin_lock(&a->tx_lock);
+	spin_lock(&a->lock);
+	spin_lock(&b->lock);
+	drop_tx();
+	drop_lock();
+	__smatch_state("check_locking", "&a->tx_lock");
+	__smatch_state("check_locking", "&a->lock");
+	__smatch_state("check_locking", "&b->lock");
+	spin_unlock(&b->lock);
+	drop_lock();
+	__smatch_state("check_locking", "&a->lock");
+}
+/*
+ * check-name: smatch locking: match DB lock names by suffix
+ * check-command: validation/smatch_sql_test.sh "drop table return_summary; insert into return_states values (0, 'drop_tx', 0, 0, '', 0, 8021, -2, '\$->tx_lock', ''); insert into return_states values (0, 'drop_lock', 0, 0, '', 0, 8021, -2, '\$->lock', '');" -p=kernel -I.. -DCONFIG_SMP=y sm_locking_best_match.c
+ *
+ * check-output-start
+sm_locking_best_match.c:20 test() '&a->tx_lock' = 'unlocked'
+sm_locking_best_match.c:21 test() '&a->lock' = 'locked'
+sm_locking_best_match.c:22 test() '&b->lock' = 'locked'
+sm_locking_best_match.c:25 test() '&a->lock' = 'unlocked'
+ * check-output-end
+ */
@@ -0,0 +1,18 @@
+#include "check_debug.h"
+
+int printk(const char *fmt, ...);
+
+void frob(int x)
+{
+	printk("x = %d %", x);
+	printk("x = %d %l", x);
+}
+/*
+ * check-name: smatch: printk() format ending in '%'
+ * check-command: smatch -p=kernel -I.. sm_printf_percent.c
+ *
+ * check-output-start
+sm_printf_percent.c:7 frob() error: format specifier '%' invalid
+sm_printf_percent.c:8 frob() error: format specifier '%l' invalid
+ * check-output-end
+ */
@@ -0,0 +1,55 @@
+#include "check_debug.h"
+
+int frob(void);
+
+int one(int *p)
+{
+	if (!p)
+		return *p;
+	return 0;
+}
+
+int two(int *p)
+{
+	int *q = 0;
+	int x = frob();
+
+	if (x)
+		q = p;
+	if (x)
+		return *q;
+	return 0;
+}
+
+int three(int *p)
+{
+	return *p;
+}
+
+struct foo {
+	int a;
+};
+
+void kfree(void *);
+
+static void release(struct foo *p)
+{
+	kfree(p);
+}
+
+int test(struct foo *p)
+{
+	release(p);
+	return p->a;
+}
+
+/*
+ * check-name: smatch --tiered
+ * check-command: smatch -p=kernel --tiered -I.. sm_tiered.c
+ * check-output-ignore
+ *
+ * check-output-contains: sm_tiered.c:8 one() error: we previously assumed 'p' could be null (see line 7)
+ * check-output-contains: sm_tiered.c:43 test() error: dereferencing freed memory 'p'
+ * check-output-contains: tiered: 5 functions, 2 escalated
+ * check-output-excludes: two()
+ */
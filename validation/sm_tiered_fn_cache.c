@@ -0,0 +1,40 @@
+#include "check_debug.h"
+
+static int frob(int x, int *p)
+{
+	int ret, val;
+
+	if (x == 5) {
+		ret = -22;
+		val = 8;
+	} else if (x > 10) {
+		ret = -12;
+		val = 8;
+	} else {
+		ret = 0;
+		val = 7;
+	}
+	*p = val;
+	return ret;
+}
+
+void test(int x, int *p)
+{
+	int ret;
+
+	ret = frob(x, p);
+	if (ret)
+		return;
+	__smatch_implied(x);
+	__smatch_implied(*p);
+}
+/*
+ * check-name: smatch --tiered --fn-cache
+ * check-command: validation/fn_cache_run.sh --tiered -I.. sm_tiered_fn_cache.c
+ * check-output-ignore
+ *
+ * check-output-contains: cold: sm_tiered_fn_cache.c:28 test() implied: x = 's32min-4,6-10'
+ * check-output-contains: cold: sm_tiered_fn_cache.c:29 test() implied: [*]p = '7'
+ * check-output-contains: warm: sm_tiered_fn_cache.c:28 test() implied: x = 's32min-4,6-10'
+ * check-output-contains: warm: sm_tiered_fn_cache.c:29 test() implied: [*]p = '7'
+ */
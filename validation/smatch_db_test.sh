@@ -1,9 +1,12 @@
 #!/bin/bash
 
-rm -f smatch_db.sqlite
+# Build the DB in a private directory so that several of these tests can
+# run at the same time (test-suite -j).
+tmp_dir=$(mktemp -d) || exit 1
+data_dir=$(cd ../smatch_data/db && pwd)
 
-./build_smatch_db.sh $*
-../smatch $*
-
-rm smatch_db.sqlite
+../smatch --info $* > $tmp_dir/warns.txt
+(cd $tmp_dir && $data_dir/create_db.sh warns.txt > /dev/null 2>&1)
+../smatch --db-file=$tmp_dir/smatch_db.sqlite $*
 
+rm -rf $tmp_dir
@@ -0,0 +1,18 @@
+#!/bin/bash
+
+# Runs smatch against an empty DB with only the rows which the test adds.
+# The first argument is the SQL to run on the DB, the rest are passed to
+# smatch.  This doesn't need the perl DB scripts like smatch_db_test.sh.
+sql=$1
+shift
+
+tmp_dir=$(mktemp -d) || exit 1
+db=$tmp_dir/smatch_db.sqlite
+
+for i in ../smatch_data/db/*.schema ; do
+	sqlite3 $db < $i > /dev/null
+done
+sqlite3 $db "$sql"
+../smatch --db-file=$db $*
+
+rm -rf $tmp_dir